@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Copies a GPU buffer range into a ring of host-visible slots and hands back the newest finished copy
+// without stalling. Each enqueue() records a GPU-side copy plus a fence; poll() harvests the slots whose
+// fences have signalled, so snapshots trail the GPU by up to `depth` frames. readNow() is the explicit
+// blocking path for callers that need the current contents.
+class AsyncReadback {
+public:
+    AsyncReadback(std::size_t bytes, std::size_t depth);
+    ~AsyncReadback();
+
+    AsyncReadback(const AsyncReadback&) = delete;
+    AsyncReadback& operator=(const AsyncReadback&) = delete;
+
+    // Returns false, dropping the request, when every slot is still in flight.
+    bool enqueue(unsigned int sourceBuffer, std::size_t sourceOffset = 0);
+    void poll();
+    void readNow(unsigned int sourceBuffer, std::size_t sourceOffset = 0);
+    // Forgets in-flight copies and the current snapshot, e.g. after the source has been re-initialized.
+    void discard();
+
+    bool hasSnapshot() const;
+    const void* snapshot() const;
+    // Increases whenever a newer snapshot is taken (or discard() is called); compare to detect fresh data.
+    std::uint64_t snapshotSerial() const;
+    std::size_t size() const;
+
+private:
+    struct Slot {
+        void* fence;
+        std::uint64_t serial;
+    };
+
+    std::size_t m_bytes;
+    unsigned int m_buffer;
+    unsigned char* m_mapped;
+    std::vector<Slot> m_slots;
+    std::size_t m_nextSlot;
+    std::uint64_t m_serial;
+    std::vector<unsigned char> m_snapshot;
+    std::uint64_t m_snapshotSerial;
+    bool m_hasSnapshot;
+
+    void releaseSlot(Slot& slot);
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "ObjLoader.h"
+#include "SdfGrid.h"
+
+enum class ColliderShape : int {
+    Sphere = 0,
+    Capsule = 1,
+    Box = 2,
+    TriangleMesh = 3,
+    Sdf = 4,
+};
+
+// std430 record consumed by cloth_step.comp; layout must match the shader's Collider struct.
+struct GpuColliderRecord {
+    glm::vec4 boundsMin;  // w: shape
+    glm::vec4 boundsMax;  // w: radius
+    glm::vec4 center;     // sphere centre, capsule end A, box/SDF centre (w: SDF scale)
+    glm::vec4 axisX;      // capsule end B, box/SDF axis X (w: box half extent)
+    glm::vec4 axisY;      // box/SDF axis Y (w: box half extent)
+    glm::vec4 axisZ;      // box/SDF axis Z (w: box half extent)
+    glm::vec4 sdfGrid;    // SDF lattice origin in object space (w: voxel size)
+    glm::uvec4 sdfLayout; // SDF brick dims (w: word offset of its brick table in sdfData)
+};
+
+// Everything the GPU narrowphase needs. Each SDF contributes its brick table followed by its samples (as
+// float bits) to `sdfData`; non-negative table entries are rewritten to the word offset of the brick's samples.
+struct GpuColliderData {
+    std::vector<GpuColliderRecord> records;
+    std::vector<std::uint32_t> sdfData;
+};
+
+// Static collision geometry shared by the cloth solvers. Shapes are added up front, then build()
+// creates the broadphase BVH over their world-space bounds.
+class ColliderSet {
+public:
+    void addSphere(const glm::vec3& center, float radius);
+    void addCapsule(const glm::vec3& a, const glm::vec3& b, float radius);
+    void addBox(const glm::mat4& unitCubeModel);
+    void addTriangleMesh(const ObjMeshData& mesh, const glm::mat4& model);
+    // `model` must be a rotation, uniform scale and translation; the grid is in the mesh's object space.
+    void addSdf(std::shared_ptr<const SdfGrid> sdf, const glm::mat4& model);
+    void clear();
+    void build();
+
+    std::size_t size() const;
+    bool empty() const;
+    // False after any add or clear until the next build().
+    bool isBuilt() const;
+
+    void queryOverlaps(const glm::vec3& boundsMin, const glm::vec3& boundsMax, std::vector<std::uint32_t>& out) const;
+    bool resolveParticle(std::uint32_t collider, glm::vec3& position, glm::vec3& velocity, float thickness, float friction) const;
+
+    GpuColliderData gpuData() const;
+
+private:
+    struct Collider {
+        ColliderShape shape;
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        glm::vec3 center;
+        glm::vec3 endB;
+        glm::vec3 axes[3];
+        glm::vec3 halfExtents;
+        float radius;
+        float scale;
+        int mesh;
+        std::shared_ptr<const SdfGrid> sdf;
+    };
+
+    struct BvhNode {
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        std::uint32_t first;
+        std::uint32_t count;
+        int left;
+        int right;
+    };
+
+    struct TriangleMesh {
+        std::vector<glm::vec3> corners;
+        std::vector<std::uint32_t> order;
+        std::vector<BvhNode> nodes;
+    };
+
+    std::vector<Collider> m_colliders;
+    std::vector<TriangleMesh> m_meshes;
+    std::vector<std::uint32_t> m_order;
+    std::vector<BvhNode> m_nodes;
+    bool m_built = false;
+
+    static int buildBvh(
+        std::vector<BvhNode>& nodes,
+        std::vector<std::uint32_t>& order,
+        const std::vector<glm::vec3>& itemMin,
+        const std::vector<glm::vec3>& itemMax,
+        std::uint32_t first,
+        std::uint32_t count,
+        std::uint32_t leafSize);
+    bool resolveTriangleMesh(const TriangleMesh& mesh, glm::vec3& position, glm::vec3& normal, float thickness) const;
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "AsyncReadback.h"
+#include "GpuParamsRing.h"
+
+// One cloth in a GpuClothBatch. The grid starts flat in xz around `center` with both corners of row 0 pinned,
+// like GpuPhysicsSolver's cloth.
+struct GpuClothInstanceDesc {
+    std::size_t rows = 10;
+    std::size_t cols = 10;
+    float spacing = 0.05f;
+    glm::vec3 center = glm::vec3(0.0f, 2.35f, 0.0f);
+    float stiffness = 250.0f;
+    float damping = 0.3f;
+    float gravityScale = 1.0f;
+    float windStrength = 0.0f;
+};
+
+// Steps many independent cloths with one dispatch per substep. Every instance lives in a slice of shared
+// position / velocity buffers (one vec4 per particle), and a descriptor table gives each invocation its
+// cloth's offset, grid size and material. No colliders or self-collision; the ground plane still applies.
+class GpuClothBatch {
+public:
+    explicit GpuClothBatch(const std::vector<GpuClothInstanceDesc>& instances);
+    ~GpuClothBatch();
+
+    GpuClothBatch(const GpuClothBatch&) = delete;
+    GpuClothBatch& operator=(const GpuClothBatch&) = delete;
+
+    void step(float dt);
+    void reset();
+
+    void setInstanceMaterial(
+        std::size_t instance,
+        float stiffness,
+        float damping,
+        float gravityScale,
+        float windStrength);
+
+    std::size_t instanceCount() const;
+    std::size_t particleCount() const;
+    // First particle of `instance` in positionBuffer().
+    std::size_t particleOffset(std::size_t instance) const;
+    unsigned int positionBuffer() const;
+    // Blocking read of one instance's current positions.
+    std::vector<glm::vec3> readPositions(std::size_t instance) const;
+
+private:
+    struct InstanceRecord {
+        glm::ivec4 grid;
+        glm::vec4 material;
+        glm::vec4 gravity;
+        glm::vec4 wind;
+    };
+
+    std::vector<GpuClothInstanceDesc> m_instances;
+    std::vector<InstanceRecord> m_records;
+    std::size_t m_particleCount;
+
+    unsigned int m_program;
+    unsigned int m_posSsboA;
+    unsigned int m_posSsboB;
+    unsigned int m_velSsboA;
+    unsigned int m_velSsboB;
+    unsigned int m_fixedSsbo;
+    unsigned int m_healthSsbo;
+    unsigned int m_instanceSsbo;
+    unsigned int m_particleInstanceSsbo;
+    std::unique_ptr<GpuParamsRing> m_paramsRing;
+    bool m_pingPongFlip;
+
+    std::unique_ptr<AsyncReadback> m_healthReadback;
+    std::uint64_t m_healthSerial;
+
+    void uploadInitialState();
+    void bindBuffers() const;
+    static InstanceRecord makeRecord(const GpuClothInstanceDesc& desc, std::size_t firstParticle);
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "ColliderSet.h"
+#include "GpuPhysicsSolver.h"
+
+// Winning storage layout and cloth_step.comp workgroup shape for one device and grid size.
+struct GpuKernelConfig {
+    GpuParticleLayout layout = GpuParticleLayout::Vec4;
+    GpuStepKernelOptions options;
+    // GPU time of one 1/60 s step with the per-substep kernel; 0 when never measured.
+    double stepMilliseconds = 0.0;
+};
+
+// Benchmarks candidate workgroup shapes (1D and 2D) and particle storage layouts for the per-substep step
+// kernel and keeps the fastest per GL vendor / renderer / version string and grid size in a small text file,
+// so later launches on the same driver reuse it without re-measuring.
+class GpuKernelAutotuner {
+public:
+    // Times every candidate with GL_TIME_ELAPSED queries; needs a current GL 4.3 context. Candidates the
+    // driver rejects are skipped; throws std::runtime_error when none of them runs.
+    static GpuKernelConfig tune(
+        std::size_t rows,
+        std::size_t cols,
+        float spacing,
+        std::shared_ptr<const ColliderSet> colliders);
+
+    // False when the file has no entry for this device and grid.
+    static bool load(const std::string& path, std::size_t rows, std::size_t cols, GpuKernelConfig& config);
+    // Replaces this device and grid's entry, keeping the others.
+    static void save(const std::string& path, std::size_t rows, std::size_t cols, const GpuKernelConfig& config);
+
+    static std::string deviceKey();
+
+private:
+    static double timeSteps(GpuPhysicsSolver& solver);
+    static std::string entryKey(std::size_t rows, std::size_t cols);
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "GpuSimParams.h"
+
+// Uniform buffer of per-dispatch GpuSimParams records, `frames` frames deep. Every frame writes its records
+// into its own slot, through a persistent coherent mapping when GL 4.4 / ARB_buffer_storage is available and
+// with one glBufferSubData otherwise. A fence per slot keeps the CPU from overwriting records the GPU may still
+// be reading, so a frame never waits on the one just submitted.
+class GpuParamsRing {
+public:
+    GpuParamsRing(std::size_t recordsPerFrame, std::size_t frames);
+    ~GpuParamsRing();
+
+    GpuParamsRing(const GpuParamsRing&) = delete;
+    GpuParamsRing& operator=(const GpuParamsRing&) = delete;
+
+    // Waits for the current slot to be retired by the GPU, then takes records for it.
+    void beginFrame();
+    void write(std::size_t record, const GpuSimParams& params);
+    // Makes records [0, records) of this frame visible to the GPU; a no-op on the persistent mapping.
+    void upload(std::size_t records);
+    void bind(unsigned int binding, std::size_t record) const;
+    // Fences the slot after this frame's last dispatch and moves on to the next one.
+    void endFrame();
+
+private:
+    std::size_t m_recordsPerFrame;
+    std::size_t m_stride;
+    unsigned int m_buffer;
+    unsigned char* m_mapped;
+    std::vector<unsigned char> m_staging;
+    std::vector<void*> m_fences;
+    std::size_t m_frame;
+
+    std::size_t frameBase() const;
+};
@@ -1,14 +1,52 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include <glm/glm.hpp>
 
+#include "AsyncReadback.h"
+#include "ColliderSet.h"
+#include "GpuParamsRing.h"
+#include "ParticleBvh.h"
+
+// PerSubstep dispatches cloth_step.comp once per substep; Tiled runs cloth_step_tiled.comp, which advances
+// several substeps per dispatch inside shared-memory tiles. ConjugateGradient solves each implicit step to
+// convergence with cloth_cg.comp instead of taking one Jacobi sweep, so it steps at 1/60 s rather than 1/240 s.
+enum class GpuStepKernel {
+    PerSubstep,
+    Tiled,
+    ConjugateGradient,
+};
+
+// Compile-time shape of the step kernels; each distinct combination is compiled once and cached.
+struct GpuStepKernelOptions {
+    // Per-substep kernel workgroup; a y size above 1 maps invocations straight onto (col, row).
+    unsigned int groupSizeX = 128;
+    unsigned int groupSizeY = 1;
+    // Without bend springs the step kernels use the 8-neighbour structural/shear stencil.
+    bool bendSprings = true;
+};
+
+// Storage format of the particle position and velocity buffers (see shaders/cloth_storage.glsl). Vec4 pads
+// both to 16 bytes; Packed stores float triplets; PackedHalfVelocity also packs velocities into three halves.
+enum class GpuParticleLayout {
+    Vec4,
+    Packed,
+    PackedHalfVelocity,
+};
+
 class GpuPhysicsSolver {
 public:
-    GpuPhysicsSolver(std::size_t rows, std::size_t cols, float spacing);
+    GpuPhysicsSolver(
+        std::size_t rows,
+        std::size_t cols,
+        float spacing,
+        GpuParticleLayout layout = GpuParticleLayout::Vec4);
     ~GpuPhysicsSolver();
 
     GpuPhysicsSolver(const GpuPhysicsSolver&) = delete;
@@ -17,7 +55,21 @@ public:
     void step(float dt);
     void reset();
 
+    // Newest finished position snapshot. Steps copy nothing back on their own: requestPositions() queues an
+    // asynchronous copy that lands a few frames later, and syncPositions() blocks for the current state instead.
     const std::vector<glm::vec3>& getPositions() const;
+    void requestPositions();
+    void syncPositions();
+    // Conservative world AABB of the current cloth: the newest GPU-reduced bounds grown by how far particles can
+    // have moved since (maxSpeed over the frames in flight), plus the drag target.
+    void getBounds(glm::vec3& boundsMin, glm::vec3& boundsMax) const;
+    // Current-frame GPU buffers for rendering without a readback. Positions are positionStride() bytes apart;
+    // normals are one octahedral snorm16x2 word per particle, as Mesh stores them.
+    unsigned int positionBuffer() const;
+    unsigned int normalBuffer() const;
+    GpuParticleLayout particleLayout() const;
+    std::size_t positionStride() const;
+    std::size_t velocityStride() const;
     float getStiffness() const;
     float getDamping() const;
     float getGravityScale() const;
@@ -27,19 +79,30 @@ public:
     void setDamping(float damping);
     void setGravityScale(float gravityScale);
     void setWindStrength(float windStrength);
+    void setSelfCollisionEnabled(bool enabled);
+    bool isSelfCollisionEnabled() const;
+    // The next three build the step kernel variant they select before returning. If it fails to compile they
+    // throw std::runtime_error and keep the previous setting, so step() never compiles.
+    void setColliders(std::shared_ptr<const ColliderSet> colliders);
+    void setStepKernel(GpuStepKernel kernel);
+    GpuStepKernel stepKernel() const;
+    void setStepKernelOptions(const GpuStepKernelOptions& options);
+    const GpuStepKernelOptions& stepKernelOptions() const;
+    // Jacobi strain-limiting iterations after each step dispatch; 0 disables the pass.
+    void setStrainIterations(int iterations);
+    int strainIterations() const;
+    // CG iterations per step for GpuStepKernel::ConjugateGradient; converged iterations become no-ops.
+    void setCgIterations(int iterations);
+    int cgIterations() const;
 
     bool beginDrag(const glm::vec3& rayOrigin, const glm::vec3& rayDir, float maxDistance);
     void updateDrag(const glm::vec3& worldTarget);
     void updateDragFromRay(const glm::vec3& rayOrigin, const glm::vec3& rayDir);
     void endDrag();
     bool isDragging() const;
+    std::vector<ParticlePickHit> pickParticles(const std::vector<ParticleRay>& rays, float maxDistance) const;
 
 private:
-    struct GpuParticle {
-        glm::vec4 pos;
-        glm::vec4 vel;
-    };
-
     std::size_t m_rows;
     std::size_t m_cols;
     float m_spacing;
@@ -53,28 +116,96 @@ private:
     float m_groundY;
     glm::vec3 m_gravity;
     glm::vec3 m_wind;
+    bool m_selfCollision;
+    float m_selfCollisionThickness;
+    float m_colliderThickness;
+    float m_colliderFriction;
+    int m_colliderCount;
+    GpuStepKernel m_stepKernel;
+    GpuStepKernelOptions m_stepOptions;
+    GpuParticleLayout m_layout;
+    int m_strainIterations;
+    int m_cgIterations;
 
     std::vector<glm::vec3> m_positionsCpu;
+    bool m_positionsStale;
+    glm::vec3 m_boundsMin;
+    glm::vec3 m_boundsMax;
+    bool m_boundsStale;
+    float m_lastStepDt;
     std::vector<int> m_fixedFlags;
 
     int m_draggedIndex;
     float m_dragRayT;
     glm::vec3 m_dragTarget;
 
-    unsigned int m_computeProgram;
+    // Grid constants and the storage layout, injected into every solver kernel.
+    std::vector<std::string> m_kernelDefines;
+    // A compiled step kernel variant; the CG kernel's pass uniforms are looked up once at compile time.
+    struct StepProgram {
+        unsigned int program;
+        int passLocation;
+        int slotLocation;
+    };
+    // Step kernel variants keyed by their full define list.
+    std::map<std::string, StepProgram> m_stepPrograms;
+    unsigned int m_selfCollisionProgram;
+    unsigned int m_strainProgram;
+    unsigned int m_normalsProgram;
+    unsigned int m_pickProgram;
     unsigned int m_posSsboA;
     unsigned int m_posSsboB;
     unsigned int m_velSsboA;
     unsigned int m_velSsboB;
     unsigned int m_fixedSsbo;
+    unsigned int m_healthSsbo;
+    unsigned int m_normalSsbo;
+    unsigned int m_boundsSsbo;
+    unsigned int m_pickSsbo;
+    unsigned int m_pickRaySsbo;
+    unsigned int m_colliderSsbo;
+    unsigned int m_sdfSsbo;
+    unsigned int m_collisionScratchSsbo;
+    unsigned int m_hashSsbo;
+    unsigned int m_hashTableSize;
+    int m_selfCollisionPassLocation;
+    int m_strainSourceLocation;
+    bool m_pickInt64;
+    int m_pickPassLocation;
+    int m_pickPosIndexLocation;
+    int m_pickRayCountLocation;
+    int m_pickRayBaseLocation;
+    int m_pickMaxDistanceLocation;
+
+    // Per-dispatch SimParams records, kParamsFrames frames deep.
+    static constexpr std::size_t kParamsFrames = 3;
+    std::unique_ptr<GpuParamsRing> m_paramsRing;
     bool m_pingPongFlip;
 
+    std::unique_ptr<AsyncReadback> m_positionReadback;
+    std::unique_ptr<AsyncReadback> m_healthReadback;
+    std::unique_ptr<AsyncReadback> m_boundsReadback;
+    std::uint64_t m_positionSerial;
+    std::uint64_t m_healthSerial;
+    std::uint64_t m_boundsSerial;
+
     std::size_t index(std::size_t row, std::size_t col) const;
     void initializeGrid();
     void pinConstraints();
     void uploadInitialStateToGpu();
-    void readBackPositions();
+    void bindStaticBuffers() const;
+    void bindStepBuffers() const;
+    void writeDispatchParams(float dt, int substeps, int substepsPerDispatch);
+    void satisfyStrainConstraints(unsigned int positionBuffer);
+    void resolveSelfCollisions(unsigned int positionBuffer);
+    void computeNormals();
+    void solveConjugateGradient(const StepProgram& program);
+    const StepProgram& stepProgram();
+    unsigned int compileSolverProgram(const std::string& path, const std::vector<std::string>& extraDefines) const;
+    std::vector<ParticlePickHit> pickOnGpu(const std::vector<ParticleRay>& rays, float maxDistance) const;
+    void applyPositionSnapshot();
+    void resetBounds();
+    bool collectReadbacks();
 
-    static std::string loadTextFile(const std::string& path);
     static unsigned int compileComputeProgram(const std::string& source);
 };
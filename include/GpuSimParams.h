@@ -0,0 +1,30 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// std140 mirror of the SimParams block in shaders/cloth_params.glsl; one record per dispatch.
+struct GpuSimParams {
+    int rows;
+    int cols;
+    int numParticles;
+    int draggedIndex;
+    float dt;
+    float spacing;
+    float mass;
+    float stiffness;
+    float damping;
+    float springDamping;
+    float maxSpeed;
+    float groundY;
+    glm::vec3 gravity;
+    int colliderCount;
+    glm::vec3 wind;
+    float colliderThickness;
+    glm::vec3 dragTarget;
+    float colliderFriction;
+    int readIndex;
+    unsigned int tableMask;
+    float selfCollisionThickness;
+    int tileSubsteps;
+};
+static_assert(sizeof(GpuSimParams) == 112, "GpuSimParams must match the std140 SimParams block");
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Pool of GL_TIME_ELAPSED queries for timing consecutive GPU sections of a frame. Each section has one
+// query per frame slot; a slot is read back when it comes round again, `latency` frames later, and only if
+// the result is already available, so reading never stalls. Sections cannot nest.
+class GpuTimer {
+public:
+    explicit GpuTimer(std::size_t sectionCount, std::size_t latency = 2);
+    ~GpuTimer();
+
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    void beginFrame();
+    void begin(std::size_t section);
+    void end();
+
+    // Most recent collected time; 0 when the section was not issued in that frame.
+    double milliseconds(std::size_t section) const;
+
+private:
+    std::size_t m_sectionCount;
+    std::size_t m_latency;
+    std::vector<unsigned int> m_queries;
+    std::vector<std::uint8_t> m_issued;
+    std::vector<double> m_milliseconds;
+    std::size_t m_slot;
+    bool m_active;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Triangle-list reordering for the post-transform vertex cache and for overdraw. Only the order of triangles
+// changes; each keeps its corners and winding.
+class IndexOptimizer {
+public:
+    // Forsyth's linear-speed vertex cache optimization against a 32-entry LRU model.
+    static void optimizeVertexCache(std::vector<unsigned int>& indices, std::size_t vertexCount);
+
+    // Splits a cache-optimized list into clusters where the cache is cold anyway (or nearly so, within
+    // `threshold` of the cluster's own miss ratio), then draws outward-facing clusters first so their
+    // fragments occlude the rest. Meant for static meshes; positions are object space.
+    static void optimizeOverdraw(
+        std::vector<unsigned int>& indices,
+        const std::vector<glm::vec3>& positions,
+        float threshold = 1.05f);
+
+    // Average transformed vertices per triangle with a FIFO cache of `cacheSize` entries: 3 is a cold cache on
+    // every triangle, 0.5 the limit for a large regular grid.
+    static float averageCacheMissRatio(
+        const std::vector<unsigned int>& indices,
+        std::size_t vertexCount,
+        std::size_t cacheSize = 16);
+
+    // Merges bit-identical vertices and rewrites `indices` to match. Returns the remap from old to new index.
+    template <typename Vertex>
+    static std::vector<unsigned int> weldVertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+private:
+    static std::vector<unsigned int> weldRemap(const void* vertices, std::size_t vertexCount, std::size_t stride);
+};
+
+template <typename Vertex>
+std::vector<unsigned int> IndexOptimizer::weldVertices(
+    std::vector<Vertex>& vertices,
+    std::vector<unsigned int>& indices) {
+    std::vector<unsigned int> remap = weldRemap(vertices.data(), vertices.size(), sizeof(Vertex));
+    std::vector<Vertex> welded;
+    welded.reserve(vertices.size());
+    for (std::size_t i = 0; i < vertices.size(); ++i) {
+        if (remap[i] == welded.size()) {
+            welded.push_back(vertices[i]);
+        }
+    }
+    for (unsigned int& index : indices) {
+        index = remap[index];
+    }
+    vertices = std::move(welded);
+    return remap;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <vector>
 
 #include <glm/glm.hpp>
@@ -10,30 +11,97 @@ struct MeshVertex {
     glm::vec3 normal;
 };
 
+// Per-instance attributes read by vertex.glsl (locations 2-9) and shadow_depth_vertex.glsl (model only).
+struct MeshInstance {
+    glm::mat4 model;
+    glm::mat3 normalMatrix;
+    std::uint32_t materialIndex;  // into RenderUniforms' material table
+};
+
+// Vertices live in two non-interleaved attribute streams in one buffer: vec3 positions (location 0) followed
+// by octahedral snorm16x2 normals (location 1, see packOctahedralNormal). Static meshes keep both in a single
+// immutable upload; dynamic meshes rewrite both every frame. The depth-only VAO binds positions alone.
 class Mesh {
 public:
     Mesh(std::size_t rows, std::size_t cols, const std::vector<glm::vec3>& positions);
-    Mesh(std::vector<MeshVertex> vertices, std::vector<unsigned int> indices, bool dynamicPositions = false);
+    Mesh(const std::vector<MeshVertex>& vertices, std::vector<unsigned int> indices, bool dynamicPositions = false);
     ~Mesh();
 
     Mesh(const Mesh&) = delete;
     Mesh& operator=(const Mesh&) = delete;
 
+    // Dynamic meshes write positions and recomputed normals straight into a persistently mapped vertex ring
+    // when GL 4.4 / ARB_buffer_storage is available, and re-upload the whole buffer otherwise.
     void updatePositions(const std::vector<glm::vec3>& positions);
+    // Draws from GPU buffers (e.g. solver SSBOs) instead of the mesh's own vertex buffer: positions are
+    // positionStride bytes apart, normals packed octahedral like the mesh's own. Passing 0 for both switches
+    // back to the CPU-fed buffer.
+    void setExternalStreams(unsigned int positionBuffer, unsigned int normalBuffer, std::size_t positionStride);
+    // Instanced draws read `MeshInstance` records from `buffer`, starting at mainOffset for draw() /
+    // drawInstanced() and at depthOffset for the depth draws; non-instanced draws then use the first record.
+    void setInstanceStream(unsigned int buffer, std::size_t mainOffset, std::size_t depthOffset);
     void draw() const;
+    void drawInstanced(std::size_t instanceCount) const;
+    // Position-only draws for depth passes.
+    void drawDepth() const;
+    void drawDepthInstanced(std::size_t instanceCount) const;
+
+    // Object-space bounds of the positions the mesh was created with.
+    const glm::vec3& boundsMin() const;
+    const glm::vec3& boundsMax() const;
+
+    // Sets the instance attributes that draws without an instance stream (the cloth) read.
+    static void setCurrentInstance(const MeshInstance& instance);
+    static MeshInstance makeInstance(const glm::mat4& model, std::uint32_t materialIndex);
 
 private:
     std::size_t m_rows;
     std::size_t m_cols;
-    std::vector<MeshVertex> m_vertices;
+    std::size_t m_vertexCount;
+    // Initial contents, and the staging copy on the glBufferData fallback.
+    std::vector<glm::vec3> m_positions;
+    std::vector<std::uint32_t> m_normals;
     std::vector<unsigned int> m_indices;
+    // GL_UNSIGNED_SHORT whenever every index fits in 16 bits; m_indices stays 32-bit on the CPU.
+    unsigned int m_indexType;
     bool m_dynamicPositions;
+    // Index-driven dynamic meshes only: triangles incident to each vertex (CSR, one entry per corner) and
+    // per-triangle scratch normals for the gather in recomputeIndexedNormals.
+    std::vector<unsigned int> m_vertexTriangleOffsets;
+    std::vector<unsigned int> m_vertexTriangles;
+    std::vector<glm::vec3> m_faceNormals;
 
     unsigned int m_vao;
+    unsigned int m_depthVao;
     unsigned int m_vbo;
     unsigned int m_ebo;
+    unsigned int m_externalVao;
+    unsigned int m_externalDepthVao;
+    unsigned int m_externalPositions;
+    unsigned int m_externalNormals;
+    std::size_t m_externalPositionStride;
+    unsigned int m_instanceBuffer;
+    glm::vec3 m_boundsMin;
+    glm::vec3 m_boundsMax;
+    // kRingFrames copies of the vertex buffer for dynamic meshes, each guarded by a fence placed once the
+    // frame that drew it has been submitted. m_ringMapped is null on the glBufferData fallback.
+    static constexpr std::size_t kRingFrames = 3;
+    void* m_ringMapped;
+    std::size_t m_ringSlot;
+    void* m_ringFences[kRingFrames];
 
+    // Grid triangles in vertex-cache order (IndexOptimizer); the normal stencils only depend on the grid.
     void buildIndexBuffer();
-    void recomputeNormals();
+    void buildVertexTriangleIndex();
+    // Writes packed normals to `out`, which may be write-combined mapped memory: it is never read.
+    void recomputeNormals(const glm::vec3* positions, std::uint32_t* out);
+    void recomputeGridNormals(const glm::vec3* positions, std::uint32_t* out);
+    void recomputeIndexedNormals(const glm::vec3* positions, std::uint32_t* out);
+    void createVertexArrays();
     void uploadToGpu(bool dynamicOnly);
+    std::size_t slotBytes() const;
+    unsigned char* acquireRingSlot();
+    void bindVertexSlot(std::size_t slot);
+    void computeBounds();
+    void bindInstanceAttributes(unsigned int vertexArray, std::size_t byteOffset, bool depthOnly) const;
 };
@@ -5,6 +5,8 @@
 
 #include "Mesh.h"
 
+// Indexed triangles: identical position / normal pairs are welded into one vertex, and the triangle order is
+// optimized for the vertex cache and for overdraw (see IndexOptimizer).
 struct ObjMeshData {
     std::vector<MeshVertex> vertices;
     std::vector<unsigned int> indices;
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+struct ParticleRay {
+    glm::vec3 origin;
+    glm::vec3 direction;
+};
+
+struct ParticlePickHit {
+    int index = -1;
+    float t = 0.0f;
+    float distance = 0.0f;
+};
+
+// Bounding volume hierarchy over the particles of a rows x cols cloth grid.
+// The topology is built once from grid tiles; only the bounds change per step, either through a full refit or by
+// the solver growing leaf bounds while it writes positions and then calling refitFromLeaves.
+class ParticleBvh {
+public:
+    struct Node {
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        std::uint32_t rowBegin;
+        std::uint32_t rowEnd;
+        std::uint32_t colBegin;
+        std::uint32_t colEnd;
+        int left;
+        int right;
+    };
+
+    void build(std::size_t rows, std::size_t cols);
+    void setLocked(std::size_t index, bool locked);
+    void refit(const std::vector<glm::vec3>& positions);
+
+    // Leaves are addressed by node index; particleLeaves() maps each particle to the leaf tile that holds it.
+    void clearLeafBounds();
+    void growLeaf(std::uint32_t leaf, const glm::vec3& position);
+    void setLeafBounds(std::uint32_t leaf, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+    void refitFromLeaves();
+
+    ParticlePickHit pick(const ParticleRay& ray, float maxDistance, const std::vector<glm::vec3>& positions) const;
+    std::vector<ParticlePickHit> pickBatch(
+        const std::vector<ParticleRay>& rays,
+        float maxDistance,
+        const std::vector<glm::vec3>& positions) const;
+
+    const std::vector<Node>& nodes() const;
+    const std::vector<std::uint32_t>& leafNodes() const;
+    const std::vector<std::uint32_t>& particleLeaves() const;
+
+private:
+    std::size_t m_rows = 0;
+    std::size_t m_cols = 0;
+    std::vector<Node> m_nodes;
+    std::vector<std::uint8_t> m_locked;
+    std::vector<std::uint32_t> m_leafNodes;
+    std::vector<std::uint32_t> m_particleLeaf;
+
+    int buildNode(std::uint32_t rowBegin, std::uint32_t rowEnd, std::uint32_t colBegin, std::uint32_t colEnd);
+};
+
+// Called once per written particle on the solver's last substep, so it is defined inline.
+inline void ParticleBvh::growLeaf(std::uint32_t leaf, const glm::vec3& position) {
+    Node& node = m_nodes[leaf];
+    node.boundsMin = glm::min(node.boundsMin, position);
+    node.boundsMax = glm::max(node.boundsMax, position);
+}
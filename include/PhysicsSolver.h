@@ -1,10 +1,15 @@
 #pragma once
 
 #include <cstddef>
+#include <memory>
 #include <vector>
 
 #include <glm/glm.hpp>
 
+#include "ColliderSet.h"
+#include "ParticleBvh.h"
+#include "SpatialHash.h"
+
 class PhysicsSolver {
 public:
     PhysicsSolver(std::size_t rows, std::size_t cols, float spacing);
@@ -13,6 +18,8 @@ public:
     void reset();
 
     const std::vector<glm::vec3>& getPositions() const;
+    // AABB containing the current positions: the pick BVH's root, refit from the last substep's leaf bounds.
+    void getBounds(glm::vec3& boundsMin, glm::vec3& boundsMax) const;
     float getStiffness() const;
     float getDamping() const;
     float getGravityScale() const;
@@ -22,11 +29,15 @@ public:
     void setDamping(float damping);
     void setGravityScale(float gravityScale);
     void setWindStrength(float windStrength);
+    void setSelfCollisionEnabled(bool enabled);
+    bool isSelfCollisionEnabled() const;
+    void setColliders(std::shared_ptr<const ColliderSet> colliders);
     bool beginDrag(const glm::vec3& rayOrigin, const glm::vec3& rayDir, float maxDistance);
     void updateDrag(const glm::vec3& worldTarget);
     void updateDragFromRay(const glm::vec3& rayOrigin, const glm::vec3& rayDir);
     void endDrag();
     bool isDragging() const;
+    std::vector<ParticlePickHit> pickParticles(const std::vector<ParticleRay>& rays, float maxDistance) const;
 
 private:
     struct Spring {
@@ -47,11 +58,19 @@ private:
     float m_maxStretchRatio;
     glm::vec3 m_gravity;
     glm::vec3 m_wind;
+    bool m_selfCollision;
+    float m_selfCollisionThickness;
+    float m_colliderThickness;
+    float m_colliderFriction;
 
     std::vector<glm::vec3> m_positions;
     std::vector<glm::vec3> m_velocities;
     std::vector<bool> m_fixed;
     std::vector<Spring> m_springs;
+    SpatialHash m_selfCollisionHash;
+    std::vector<glm::vec3> m_collisionDelta;
+    ParticleBvh m_pickBvh;
+    std::shared_ptr<const ColliderSet> m_colliders;
     int m_draggedIndex;
     float m_dragRayT;
     glm::vec3 m_dragTarget;
@@ -61,6 +80,8 @@ private:
     void initializeGrid();
     void initializeSprings();
     void pinConstraints();
-    void integrateSubstep(float dt);
-    void satisfyStrainConstraints();
+    bool integrateSubstep(float dt, bool boundLeaves);
+    bool resolveColliderContacts(bool boundLeaves);
+    bool satisfyStrainConstraints(bool boundLeaves);
+    bool resolveSelfCollisions(bool boundLeaves);
 };
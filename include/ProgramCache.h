@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Builds linked GL programs, keeping their driver binaries on disk (glGetProgramBinary) so later launches
+// skip compilation. Entries are keyed by the stage sources (defines included) plus the GL vendor, renderer
+// and version strings; a missing, stale or rejected binary falls back to compiling from source.
+class ProgramCache {
+public:
+    struct Stage {
+        unsigned int type;
+        std::string source;
+    };
+
+    // An empty directory (the default) disables the cache.
+    static void setDirectory(const std::string& directory);
+    static const std::string& directory();
+
+    // Reads a shader file, expanding `#include "file"` lines relative to it.
+    static std::string loadSource(const std::string& path);
+    static std::string insertDefines(const std::string& source, const std::vector<std::string>& defines);
+
+    // Returns a linked program; throws std::runtime_error when a stage fails to compile or link.
+    static unsigned int build(const std::vector<Stage>& stages);
+
+private:
+    static unsigned int loadBinary(const std::string& path, std::uint64_t key);
+    static void saveBinary(const std::string& path, std::uint64_t key, unsigned int program);
+    static unsigned int compileStage(const Stage& stage);
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+
+// std140 mirror of the FrameUniforms block in vertex.glsl, fragment.glsl and shadow_depth_vertex.glsl.
+struct FrameUniformData {
+    glm::mat4 view;
+    glm::mat4 proj;
+    glm::mat4 lightSpace;
+    glm::vec4 cameraPos;        // xyz
+    glm::vec4 lightDir;         // xyz, towards the light
+    glm::vec4 pointLightPos;    // xyz
+    glm::vec4 pointLightColor;  // rgb, a: intensity
+    glm::vec4 lighting;         // x: ambient strength
+};
+static_assert(sizeof(FrameUniformData) == 272, "FrameUniformData must match the std140 FrameUniforms block");
+
+// std140 mirror of one Material in fragment.glsl's MaterialUniforms block.
+struct MaterialData {
+    glm::vec4 baseColorSpecular;  // rgb: base color, a: specular strength
+    glm::vec4 shininess;          // x
+};
+static_assert(sizeof(MaterialData) == 32, "MaterialData must match the std140 Material struct");
+
+// The render passes' shared uniform buffers: frame constants written once per frame and a material table that
+// instances index (MeshInstance::materialIndex). Bindings start at 1; binding 0 belongs to the solvers'
+// SimParams block.
+class RenderUniforms {
+public:
+    static constexpr unsigned int kFrameBinding = 1;
+    static constexpr unsigned int kMaterialBinding = 2;
+    // Mirrored by MAX_MATERIALS in fragment.glsl.
+    static constexpr std::size_t kMaxMaterials = 64;
+
+    RenderUniforms();
+    ~RenderUniforms();
+
+    RenderUniforms(const RenderUniforms&) = delete;
+    RenderUniforms& operator=(const RenderUniforms&) = delete;
+
+    // Returns the index of an identical existing material or appends one; throws std::runtime_error once the
+    // table is full.
+    std::uint32_t addMaterial(const glm::vec3& baseColor, float specularStrength, float shininess);
+    // Connects the shader's FrameUniforms / MaterialUniforms blocks to this object's bindings.
+    void attach(const Shader& shader) const;
+    // Uploads the frame block, and the material table when it changed, then binds both.
+    void update(const FrameUniformData& frame);
+
+    std::size_t materialCount() const;
+
+private:
+    std::vector<MaterialData> m_materials;
+    bool m_materialsDirty;
+    unsigned int m_frameUbo;
+    unsigned int m_materialUbo;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Six inward-facing planes (xyz: normal, w: offset) of a GL clip volume, extracted from a view-projection
+// matrix; works for perspective and orthographic projections alike.
+struct Frustum {
+    glm::vec4 planes[6];
+
+    static Frustum fromMatrix(const glm::mat4& viewProjection);
+    bool intersects(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const;
+};
+
+// Bounding volume hierarchy over world-space AABBs of static scene objects, split at the median of the widest
+// centroid axis. Culling skips plane tests below nodes that lie entirely inside a plane.
+class SceneBvh {
+public:
+    struct Node {
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        std::uint32_t itemBegin;  // range into the item order, for leaves and for accepting whole subtrees
+        std::uint32_t itemEnd;
+        int left;
+        int right;
+    };
+
+    void build(const std::vector<glm::vec3>& boundsMin, const std::vector<glm::vec3>& boundsMax);
+
+    // Appends the indices of items whose bounds intersect the frustum (in tree order) and returns the number of
+    // nodes tested.
+    std::size_t cull(const Frustum& frustum, std::vector<std::uint32_t>& visible) const;
+
+    std::size_t itemCount() const;
+    const std::vector<Node>& nodes() const;
+
+private:
+    std::vector<Node> m_nodes;
+    std::vector<std::uint32_t> m_items;
+    std::vector<glm::vec3> m_itemMin;
+    std::vector<glm::vec3> m_itemMax;
+
+    int buildNode(std::uint32_t begin, std::uint32_t end);
+};
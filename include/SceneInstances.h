@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+#include "SceneBvh.h"
+
+enum class ScenePass { Main = 0, Depth = 1 };
+
+struct SceneCullStats {
+    std::size_t visible = 0;
+    std::size_t culled = 0;
+    std::size_t nodesTested = 0;
+};
+
+// Static scene props grouped by mesh, with a SceneBvh over their world bounds. Each pass culls against its own
+// frustum and writes the survivors' MeshInstance records into its half of one instance buffer, where every mesh
+// owns a fixed slice; the pass then issues one glDrawElementsInstanced per mesh that has survivors.
+class SceneInstances {
+public:
+    SceneInstances();
+    ~SceneInstances();
+
+    SceneInstances(const SceneInstances&) = delete;
+    SceneInstances& operator=(const SceneInstances&) = delete;
+
+    void add(const std::shared_ptr<Mesh>& mesh, const glm::mat4& model, std::uint32_t materialIndex);
+    // Builds the BVH, sizes the instance buffer and points each mesh at its slices; call again after adding more.
+    void upload();
+
+    // Runs before the pass's draws each frame; a pass that was never culled draws nothing.
+    void cull(ScenePass pass, const glm::mat4& viewProjection);
+    void draw() const;
+    void drawDepth() const;
+
+    std::size_t instanceCount() const;
+    std::size_t batchCount() const;
+    const SceneCullStats& cullStats(ScenePass pass) const;
+
+private:
+    struct Batch {
+        std::shared_ptr<Mesh> mesh;
+        std::vector<MeshInstance> instances;
+        std::size_t first = 0;  // slice start within each pass's half of the buffer
+        std::size_t visible[2] = {0, 0};
+    };
+
+    struct InstanceRef {
+        std::uint32_t batch;
+        std::uint32_t instance;
+    };
+
+    std::vector<Batch> m_batches;
+    // Per instance in add() order, which is also the BVH's item order.
+    std::vector<InstanceRef> m_refs;
+    std::vector<glm::vec3> m_boundsMin;
+    std::vector<glm::vec3> m_boundsMax;
+    SceneBvh m_bvh;
+    std::vector<std::uint32_t> m_visible;
+    std::vector<MeshInstance> m_staging;
+    SceneCullStats m_stats[2];
+    unsigned int m_instanceVbo;
+};
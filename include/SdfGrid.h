@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "ObjLoader.h"
+
+// Sparse signed distance field on a regular lattice, stored in 8^3-cell bricks. Each stored brick keeps
+// 9^3 samples (one sample of apron), so any trilinear lookup reads a single brick. Bricks farther than the
+// narrow band from the surface are not stored; their table entry only records inside/outside.
+class SdfGrid {
+public:
+    static constexpr std::uint32_t kBrickCells = 8;
+    static constexpr std::uint32_t kBrickSamples = kBrickCells + 1;
+    static constexpr std::uint32_t kSamplesPerBrick = kBrickSamples * kBrickSamples * kBrickSamples;
+    static constexpr std::int32_t kEmptyOutside = -1;
+    static constexpr std::int32_t kEmptyInside = -2;
+
+    ~SdfGrid();
+
+    SdfGrid(const SdfGrid&) = delete;
+    SdfGrid& operator=(const SdfGrid&) = delete;
+
+    // Bakes the mesh in its own (object) space; the mesh must be closed for the inside test to hold.
+    static std::shared_ptr<SdfGrid> bake(const ObjMeshData& mesh, float voxelSize, float bandWidth);
+    static std::shared_ptr<SdfGrid> load(const std::string& path);
+    static std::shared_ptr<SdfGrid> loadOrBake(
+        const ObjMeshData& mesh,
+        float voxelSize,
+        float bandWidth,
+        const std::string& cacheDirectory);
+    static std::uint64_t cacheKey(const ObjMeshData& mesh, float voxelSize, float bandWidth);
+    static std::string cachePath(const std::string& cacheDirectory, std::uint64_t key);
+
+    void save(const std::string& path) const;
+
+    // Signed distance (negative inside). Outside the stored narrow band the band width is returned with the
+    // region's sign and `gradient`, if given, is left untouched.
+    float sample(const glm::vec3& p, glm::vec3* gradient = nullptr) const;
+    bool inNarrowBand(const glm::vec3& p) const;
+
+    const glm::vec3& origin() const;
+    float voxelSize() const;
+    float bandWidth() const;
+    glm::vec3 boundsMax() const;
+    const glm::uvec3& brickDims() const;
+    const std::int32_t* brickTable() const;
+    std::size_t brickTableSize() const;
+    const float* samples() const;
+    std::size_t brickCount() const;
+    std::uint64_t key() const;
+
+private:
+    SdfGrid();
+
+    glm::vec3 m_origin;
+    float m_voxelSize;
+    float m_bandWidth;
+    glm::uvec3 m_brickDims;
+    std::uint64_t m_key;
+    std::size_t m_brickCount;
+
+    // Either points into m_ownedTable/m_ownedSamples or into a read-only file mapping.
+    const std::int32_t* m_table;
+    const float* m_samples;
+    std::vector<std::int32_t> m_ownedTable;
+    std::vector<float> m_ownedSamples;
+    void* m_mapping;
+    std::size_t m_mappingSize;
+
+    bool locateCell(const glm::vec3& p, std::int32_t& entry, glm::uvec3& local, glm::vec3& fraction) const;
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <unordered_map>
 
 #include <glm/glm.hpp>
 
@@ -15,6 +16,10 @@ public:
     void use() const;
     unsigned int id() const;
 
+    // Points the named std140 block at a uniform buffer binding; a no-op when the program has no such block.
+    void bindUniformBlock(const std::string& blockName, unsigned int binding) const;
+
+    // Locations come from a table reflected at link time; unknown names are ignored like location -1.
     void setMat4(const std::string& name, const glm::mat4& value) const;
     void setVec3(const std::string& name, const glm::vec3& value) const;
     void setFloat(const std::string& name, float value) const;
@@ -22,7 +27,9 @@ public:
 
 private:
     unsigned int m_programId;
+    std::unordered_map<std::string, int> m_uniformLocations;
 
+    void reflectUniforms();
+    int uniformLocation(const std::string& name) const;
     static std::string readFile(const std::string& path);
-    static unsigned int compile(unsigned int type, const std::string& source);
 };
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Uniform-grid spatial hash rebuilt from scratch with a parallel, stable counting sort.
+// Particles are bucketed by hashed cell so each bucket's members are contiguous in sortedParticles().
+// Several cells may share a bucket; callers compare particleCell() against the cell they are visiting.
+class SpatialHash {
+public:
+    void build(const std::vector<glm::vec3>& positions, float cellSize);
+
+    glm::ivec3 cellOf(const glm::vec3& position) const;
+    std::uint32_t bucketOf(const glm::ivec3& cell) const;
+    std::uint32_t bucketBegin(std::uint32_t bucket) const;
+    std::uint32_t bucketEnd(std::uint32_t bucket) const;
+    const glm::ivec3& particleCell(std::size_t particle) const;
+    const std::vector<std::uint32_t>& sortedParticles() const;
+
+    static std::uint32_t tableSizeFor(std::size_t particleCount);
+    static std::uint32_t hashCell(const glm::ivec3& cell, std::uint32_t tableMask);
+
+private:
+    float m_invCellSize = 1.0f;
+    std::uint32_t m_tableMask = 0;
+    std::vector<glm::ivec3> m_particleCell;
+    std::vector<std::uint32_t> m_particleBucket;
+    std::vector<std::uint32_t> m_bucketStart;
+    std::vector<std::uint32_t> m_sortedParticles;
+    // Build scratch, kept between rebuilds.
+    std::vector<std::uint32_t> m_digitSorted;
+    std::vector<std::uint32_t> m_digitStart;
+    std::vector<std::uint32_t> m_chunkDigitOffset;
+    std::vector<std::uint32_t> m_bucketCursor;
+};
+
+// Query accessors sit on the per-neighbour hot path, so they are defined inline.
+inline std::uint32_t SpatialHash::hashCell(const glm::ivec3& cell, std::uint32_t tableMask) {
+    const std::uint32_t hx = static_cast<std::uint32_t>(cell.x) * 92837111u;
+    const std::uint32_t hy = static_cast<std::uint32_t>(cell.y) * 689287499u;
+    const std::uint32_t hz = static_cast<std::uint32_t>(cell.z) * 283923481u;
+    return (hx ^ hy ^ hz) & tableMask;
+}
+
+inline glm::ivec3 SpatialHash::cellOf(const glm::vec3& position) const {
+    return glm::ivec3(
+        static_cast<int>(std::floor(position.x * m_invCellSize)),
+        static_cast<int>(std::floor(position.y * m_invCellSize)),
+        static_cast<int>(std::floor(position.z * m_invCellSize)));
+}
+
+inline std::uint32_t SpatialHash::bucketOf(const glm::ivec3& cell) const {
+    return hashCell(cell, m_tableMask);
+}
+
+inline std::uint32_t SpatialHash::bucketBegin(std::uint32_t bucket) const {
+    return m_bucketStart[bucket];
+}
+
+inline std::uint32_t SpatialHash::bucketEnd(std::uint32_t bucket) const {
+    return m_bucketStart[bucket + 1];
+}
+
+inline const glm::ivec3& SpatialHash::particleCell(std::size_t particle) const {
+    return m_particleCell[particle];
+}
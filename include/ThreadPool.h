@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent worker pool for data-parallel loops on the simulation/render thread.
+// parallelFor blocks until every chunk has run; the calling thread works on chunks too. If a body throws, chunks
+// that have not started are skipped and the first exception is rethrown on the calling thread.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned int workerCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    static ThreadPool& shared();
+
+    std::size_t workerCount() const;
+    void parallelFor(
+        std::size_t begin,
+        std::size_t end,
+        std::size_t grain,
+        const std::function<void(std::size_t, std::size_t)>& body);
+
+private:
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+
+    const std::function<void(std::size_t, std::size_t)>* m_body;
+    std::size_t m_begin;
+    std::size_t m_end;
+    std::size_t m_grain;
+    std::size_t m_chunkCount;
+    std::atomic<std::size_t> m_nextChunk;
+    std::uint64_t m_generation;
+    std::size_t m_busyWorkers;
+    bool m_running;
+    bool m_stop;
+    std::exception_ptr m_error;
+
+    void workerLoop();
+    void runChunks();
+};
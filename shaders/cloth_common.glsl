@@ -0,0 +1,338 @@
+// Shared by the cloth solver kernels. Include after the kernel's local_size layout declaration.
+#include "cloth_params.glsl"
+#include "cloth_storage.glsl"
+
+// Storage bindings stay within the 8 that GL 4.3 guarantees. Bindings 0-4 mean the same in every solver program;
+// 5-7 hold the step kernels' health, collider and SDF blocks. Auxiliary passes define CLOTH_AUX_BINDINGS and
+// batched kernels drop the collider blocks, then bind their own buffers to the freed slots.
+
+// Ping-pong pairs; uReadIndex selects the input and the other element receives the output.
+layout(std430, binding = 0) buffer PosBuffer {
+    POSITION_ARRAY(pos);
+} posBuf[2];
+layout(std430, binding = 2) buffer VelBuffer {
+    VELOCITY_ARRAY(vel);
+} velBuf[2];
+layout(std430, binding = 4) readonly buffer FixedBuffer {
+    int fixedFlags[];
+};
+#ifndef CLOTH_AUX_BINDINGS
+layout(std430, binding = 5) buffer HealthBuffer {
+    uint nonFiniteFlag;
+#ifdef CLOTH_CG_STATE
+    // cloth_cg.comp's solver state follows the flag, so the CG kernel needs no storage block of its own.
+    vec4 cgScalars;  // x: r.z, y: alpha, z: beta, w: r.z convergence threshold
+    float cgPartials[CG_GROUPS];
+    CgParticle cg[];
+#endif
+};
+#ifndef CLOTH_BATCHED
+#define CLOTH_CONTACT_BLOCKS 1
+#endif
+#endif
+
+#ifdef CLOTH_CONTACT_BLOCKS
+struct Collider {
+    vec4 boundsMin;  // w: shape
+    vec4 boundsMax;  // w: radius
+    vec4 center;
+    vec4 axisX;      // capsule end B / box axis (w: half extent)
+    vec4 axisY;
+    vec4 axisZ;
+    vec4 sdfGrid;    // lattice origin (w: voxel size)
+    uvec4 sdfLayout; // brick dims (w: brick table offset in sdfData)
+};
+layout(std430, binding = 6) readonly buffer ColliderBuffer {
+    Collider colliders[];
+};
+// Per SDF: brick table (sample word offset, or negative when empty) followed by float-bit samples.
+layout(std430, binding = 7) readonly buffer SdfBuffer {
+    uint sdfData[];
+};
+
+const int SHAPE_SPHERE = 0;
+const int SHAPE_CAPSULE = 1;
+const int SHAPE_BOX = 2;
+const int SHAPE_SDF = 4;
+const uint SDF_BRICK_CELLS = 8u;
+const uint SDF_BRICK_SAMPLES = 9u;
+const uint MAX_GROUP_COLLIDERS = 64u;
+
+shared uint sBoundsBits[6];
+shared uint sCandidateCount;
+shared uint sCandidates[MAX_GROUP_COLLIDERS];
+#endif
+
+// Specialization switches injected by GpuPhysicsSolver: 8 springs drop the bend springs from the step
+// kernels, and CLOTH_COLLIDERS 0 compiles the collider narrowphase out when no colliders are set.
+#ifndef CLOTH_SPRING_COUNT
+#define CLOTH_SPRING_COUNT 12
+#endif
+#ifndef CLOTH_COLLIDERS
+#define CLOTH_COLLIDERS 1
+#endif
+
+// 12-neighbour stencil: structural, shear, then bend springs, as (dr, dc).
+const ivec2 SPRING_OFFSETS[12] = ivec2[12](
+    ivec2(0, -1), ivec2(0, 1), ivec2(-1, 0), ivec2(1, 0),
+    ivec2(-1, -1), ivec2(-1, 1), ivec2(1, -1), ivec2(1, 1),
+    ivec2(0, -2), ivec2(0, 2), ivec2(-2, 0), ivec2(2, 0));
+
+float springRestLength(int dr, int dc) {
+    int adr = abs(dr);
+    int adc = abs(dc);
+    if ((adr == 1 && adc == 0) || (adr == 0 && adc == 1)) {
+        return GRID_SPACING;
+    }
+    if (adr == 1 && adc == 1) {
+        return GRID_SPACING * 1.41421356237;
+    }
+    return GRID_SPACING * 2.0;
+}
+
+// Block-diagonal implicit Euler: A starts as (m + dt*damping) I and each spring adds its projected coupling.
+void beginImplicitSolve(vec3 v, out mat3 A, out vec3 rhs) {
+    float diag = uMass + uDt * MATERIAL_DAMPING;
+    A = mat3(diag, 0.0, 0.0, 0.0, diag, 0.0, 0.0, 0.0, diag);
+    rhs = uMass * v + uDt * (uMass * MATERIAL_GRAVITY + MATERIAL_WIND);
+}
+
+void addImplicitSpring(inout mat3 A, inout vec3 rhs, vec3 p, vec3 np, vec3 nv, float rest) {
+    vec3 delta = p - np;
+    float len = length(delta);
+    if (len <= 1e-6) {
+        return;
+    }
+
+    vec3 dir = delta / len;
+    float stretch = len - rest;
+
+    vec3 fPos = (-MATERIAL_STIFFNESS * stretch) * dir;
+    rhs += uDt * fPos;
+
+    float coupling = uDt * uDt * MATERIAL_STIFFNESS + uDt * uSpringDamping;
+    mat3 P = outerProduct(dir, dir);
+    A += coupling * P;
+    rhs += coupling * (P * nv);
+}
+
+// Clamps a solved velocity, advances the position by it and applies the ground plane.
+void integrateSolvedVelocity(vec3 p, inout vec3 vNew, out vec3 pNew) {
+    float speed = length(vNew);
+    if (speed > uMaxSpeed) {
+        vNew *= uMaxSpeed / speed;
+    }
+
+    pNew = p + uDt * vNew;
+
+    if (pNew.y < uGroundY) {
+        pNew.y = uGroundY;
+        vNew.y *= -0.15;
+    }
+}
+
+void finishImplicitSolve(vec3 p, mat3 A, vec3 rhs, out vec3 pNew, out vec3 vNew) {
+    vNew = inverse(A) * rhs;
+    integrateSolvedVelocity(p, vNew, pNew);
+}
+
+#ifdef CLOTH_CONTACT_BLOCKS
+void applyContact(inout vec3 p, inout vec3 v, vec3 projected, vec3 n) {
+    p = projected;
+    float vn = dot(v, n);
+    if (vn >= 0.0) {
+        return;
+    }
+    vec3 vt = v - vn * n;
+    float vtLen = length(vt);
+    float scale = vtLen > 1e-6 ? max(0.0, 1.0 - uColliderFriction * (-vn) / vtLen) : 0.0;
+    v = vt * scale;
+}
+
+float sdfAt(uint base, uvec3 s) {
+    return uintBitsToFloat(sdfData[base + (s.z * SDF_BRICK_SAMPLES + s.y) * SDF_BRICK_SAMPLES + s.x]);
+}
+
+// Trilinear lookup in object space; false outside the stored narrow band.
+bool sampleSdf(Collider col, vec3 local, out float dist, out vec3 gradient) {
+    dist = 0.0;
+    gradient = vec3(0.0);
+    vec3 gridPos = (local - col.sdfGrid.xyz) / col.sdfGrid.w;
+    uvec3 brickDims = col.sdfLayout.xyz;
+    if (any(lessThan(gridPos, vec3(0.0))) || any(greaterThanEqual(gridPos, vec3(brickDims * SDF_BRICK_CELLS)))) {
+        return false;
+    }
+
+    uvec3 cell = uvec3(floor(gridPos));
+    uvec3 brick = cell / SDF_BRICK_CELLS;
+    int entry = int(sdfData[col.sdfLayout.w + (brick.z * brickDims.y + brick.y) * brickDims.x + brick.x]);
+    if (entry < 0) {
+        return false;
+    }
+
+    uint base = uint(entry);
+    uvec3 s = cell - brick * SDF_BRICK_CELLS;
+    vec3 f = gridPos - vec3(cell);
+    float c000 = sdfAt(base, s);
+    float c100 = sdfAt(base, s + uvec3(1u, 0u, 0u));
+    float c010 = sdfAt(base, s + uvec3(0u, 1u, 0u));
+    float c110 = sdfAt(base, s + uvec3(1u, 1u, 0u));
+    float c001 = sdfAt(base, s + uvec3(0u, 0u, 1u));
+    float c101 = sdfAt(base, s + uvec3(1u, 0u, 1u));
+    float c011 = sdfAt(base, s + uvec3(0u, 1u, 1u));
+    float c111 = sdfAt(base, s + uvec3(1u, 1u, 1u));
+
+    float x00 = mix(c000, c100, f.x);
+    float x10 = mix(c010, c110, f.x);
+    float x01 = mix(c001, c101, f.x);
+    float x11 = mix(c011, c111, f.x);
+    float y0 = mix(x00, x10, f.y);
+    float y1 = mix(x01, x11, f.y);
+    dist = mix(y0, y1, f.z);
+
+    float dx0 = mix(c100 - c000, c110 - c010, f.y);
+    float dx1 = mix(c101 - c001, c111 - c011, f.y);
+    gradient = vec3(mix(dx0, dx1, f.z), mix(x10 - x00, x11 - x01, f.z), y1 - y0) / col.sdfGrid.w;
+    return true;
+}
+
+void resolveCollider(uint k, inout vec3 p, inout vec3 v) {
+    Collider col = colliders[k];
+    float t = uColliderThickness;
+    if (any(lessThan(p, col.boundsMin.xyz - t)) || any(greaterThan(p, col.boundsMax.xyz + t))) {
+        return;
+    }
+
+    int shape = int(col.boundsMin.w);
+    if (shape == SHAPE_SDF) {
+        mat3 axes = mat3(col.axisX.xyz, col.axisY.xyz, col.axisZ.xyz);
+        float scale = col.center.w;
+        vec3 local = transpose(axes) * (p - col.center.xyz) / scale;
+        float dist;
+        vec3 gradient;
+        if (!sampleSdf(col, local, dist, gradient)) {
+            return;
+        }
+        dist *= scale;
+        float gradientLength = length(gradient);
+        if (dist >= t || gradientLength <= 1e-6) {
+            return;
+        }
+        vec3 n = axes * (gradient / gradientLength);
+        applyContact(p, v, p + n * (t - dist), n);
+        return;
+    }
+
+    if (shape == SHAPE_BOX) {
+        mat3 axes = mat3(col.axisX.xyz, col.axisY.xyz, col.axisZ.xyz);
+        vec3 halfExtent = vec3(col.axisX.w, col.axisY.w, col.axisZ.w);
+        vec3 local = transpose(axes) * (p - col.center.xyz);
+        vec3 clamped = clamp(local, -halfExtent, halfExtent);
+        vec3 outside = local - clamped;
+        float outsideSq = dot(outside, outside);
+
+        vec3 nLocal = vec3(0.0);
+        vec3 projected = local;
+        if (outsideSq > 1e-12) {
+            if (outsideSq >= t * t) {
+                return;
+            }
+            nLocal = outside * inversesqrt(outsideSq);
+            projected = clamped + nLocal * t;
+        } else {
+            vec3 penetration = halfExtent - abs(local);
+            int axis = penetration.x <= penetration.y && penetration.x <= penetration.z ? 0 : (penetration.y <= penetration.z ? 1 : 2);
+            float side = local[axis] >= 0.0 ? 1.0 : -1.0;
+            nLocal[axis] = side;
+            projected[axis] = side * (halfExtent[axis] + t);
+        }
+        applyContact(p, v, col.center.xyz + axes * projected, axes * nLocal);
+        return;
+    }
+
+    vec3 core = col.center.xyz;
+    if (shape == SHAPE_CAPSULE) {
+        vec3 ab = col.axisX.xyz - core;
+        float lenSq = dot(ab, ab);
+        core += lenSq > 1e-12 ? ab * clamp(dot(p - core, ab) / lenSq, 0.0, 1.0) : vec3(0.0);
+    }
+    vec3 d = p - core;
+    float reach = col.boundsMax.w + t;
+    float distSq = dot(d, d);
+    if (distSq >= reach * reach) {
+        return;
+    }
+    float dist = sqrt(distSq);
+    vec3 n = dist > 1e-6 ? d / dist : vec3(0.0, 1.0, 0.0);
+    applyContact(p, v, core + n * reach, n);
+}
+
+// Order-preserving float <-> uint mapping so shared-memory atomicMin/atomicMax can reduce float bounds.
+uint orderedBits(float f) {
+    uint u = floatBitsToUint(f);
+    return (u & 0x80000000u) != 0u ? ~u : (u | 0x80000000u);
+}
+
+float fromOrderedBits(uint u) {
+    return uintBitsToFloat((u & 0x80000000u) != 0u ? (u & 0x7fffffffu) : ~u);
+}
+
+// Gathers the colliders overlapping this workgroup's particle bounds (inflated by `margin`) into shared
+// memory. Returns the candidate count, or a value above MAX_GROUP_COLLIDERS when the list overflowed.
+// Must be reached by every invocation of the workgroup.
+uint gatherGroupColliders(vec3 p, bool active, float margin) {
+    uint lid = gl_LocalInvocationIndex;
+    if (lid == 0u) {
+        sBoundsBits[0] = sBoundsBits[1] = sBoundsBits[2] = orderedBits(uintBitsToFloat(0x7f800000u));
+        sBoundsBits[3] = sBoundsBits[4] = sBoundsBits[5] = orderedBits(uintBitsToFloat(0xff800000u));
+        sCandidateCount = 0u;
+    }
+    barrier();
+
+    if (active) {
+        atomicMin(sBoundsBits[0], orderedBits(p.x));
+        atomicMin(sBoundsBits[1], orderedBits(p.y));
+        atomicMin(sBoundsBits[2], orderedBits(p.z));
+        atomicMax(sBoundsBits[3], orderedBits(p.x));
+        atomicMax(sBoundsBits[4], orderedBits(p.y));
+        atomicMax(sBoundsBits[5], orderedBits(p.z));
+    }
+    barrier();
+
+    vec3 groupMin = vec3(fromOrderedBits(sBoundsBits[0]), fromOrderedBits(sBoundsBits[1]), fromOrderedBits(sBoundsBits[2])) - margin;
+    vec3 groupMax = vec3(fromOrderedBits(sBoundsBits[3]), fromOrderedBits(sBoundsBits[4]), fromOrderedBits(sBoundsBits[5])) + margin;
+    uint threads = gl_WorkGroupSize.x * gl_WorkGroupSize.y * gl_WorkGroupSize.z;
+    for (uint k = lid; k < uint(uColliderCount); k += threads) {
+        Collider col = colliders[k];
+        if (all(lessThanEqual(col.boundsMin.xyz, groupMax)) && all(greaterThanEqual(col.boundsMax.xyz, groupMin))) {
+            uint slot = atomicAdd(sCandidateCount, 1u);
+            if (slot < MAX_GROUP_COLLIDERS) {
+                sCandidates[slot] = k;
+            }
+        }
+    }
+    barrier();
+    return sCandidateCount;
+}
+
+void resolveGroupColliders(uint candidateCount, inout vec3 p, inout vec3 v) {
+    if (candidateCount <= MAX_GROUP_COLLIDERS) {
+        for (uint s = 0u; s < candidateCount; ++s) {
+            resolveCollider(sCandidates[s], p, v);
+        }
+    } else {
+        for (uint k = 0u; k < uint(uColliderCount); ++k) {
+            resolveCollider(k, p, v);
+        }
+    }
+}
+
+#endif
+
+#ifndef CLOTH_AUX_BINDINGS
+void reportNonFinite(vec3 p, vec3 v) {
+    if (any(isnan(p)) || any(isinf(p)) || any(isnan(v)) || any(isinf(v))) {
+        atomicOr(nonFiniteFlag, 1u);
+    }
+}
+#endif
@@ -0,0 +1,61 @@
+// Per-dispatch solver parameters (std140); mirrored by GpuSimParams in GpuSimParams.h.
+layout(std140, binding = 0) uniform SimParams {
+    int uRows;
+    int uCols;
+    int uNumParticles;
+    int uDraggedIndex;
+    float uDt;
+    float uSpacing;
+    float uMass;
+    float uStiffness;
+    float uDamping;
+    float uSpringDamping;
+    float uMaxSpeed;
+    float uGroundY;
+    vec3 uGravity;
+    int uColliderCount;
+    vec3 uWind;
+    float uColliderThickness;
+    vec3 uDragTarget;
+    float uColliderFriction;
+    int uReadIndex;
+    uint uTableMask;
+    float uSelfCollisionThickness;
+    int uTileSubsteps;
+};
+
+// Grid constants and per-cloth material. GpuPhysicsSolver injects CLOTH_ROWS / CLOTH_COLS / CLOTH_SPACING so
+// they fold at compile time (row/col divides become multiplies); without them the kernels fall back to the
+// uniforms above. Batched kernels (CLOTH_BATCHED) serve many grids per dispatch and fill the g* globals from
+// their instance record before touching the grid.
+#if defined(CLOTH_BATCHED)
+int gGridRows;
+int gGridCols;
+float gGridSpacing;
+float gStiffness;
+float gDamping;
+vec3 gGravity;
+vec3 gWind;
+#define GRID_ROWS gGridRows
+#define GRID_COLS gGridCols
+#define GRID_SPACING gGridSpacing
+#define MATERIAL_STIFFNESS gStiffness
+#define MATERIAL_DAMPING gDamping
+#define MATERIAL_GRAVITY gGravity
+#define MATERIAL_WIND gWind
+#else
+#ifdef CLOTH_ROWS
+#define GRID_ROWS CLOTH_ROWS
+#define GRID_COLS CLOTH_COLS
+#define GRID_SPACING CLOTH_SPACING
+#else
+#define GRID_ROWS uRows
+#define GRID_COLS uCols
+#define GRID_SPACING uSpacing
+#endif
+#define MATERIAL_STIFFNESS uStiffness
+#define MATERIAL_DAMPING uDamping
+#define MATERIAL_GRAVITY uGravity
+#define MATERIAL_WIND uWind
+#endif
+#define GRID_PARTICLES (GRID_ROWS * GRID_COLS)
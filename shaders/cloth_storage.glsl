@@ -0,0 +1,28 @@
+// Particle storage formats, selected by GpuParticleLayout. Blocks declare their arrays with the *_ARRAY
+// macros and go through LOAD_*/STORE_*, so a kernel never depends on the element type.
+//   default             positions and velocities as vec4 (32 bytes per particle)
+//   CLOTH_PACKED_STATE  both as tightly packed float triplets (24 bytes)
+//   CLOTH_HALF_VELOCITY packed positions, velocities as three halves in a uvec2 (20 bytes)
+#if defined(CLOTH_HALF_VELOCITY) && !defined(CLOTH_PACKED_STATE)
+#define CLOTH_PACKED_STATE 1
+#endif
+
+#ifdef CLOTH_PACKED_STATE
+#define POSITION_ARRAY(name) float name[]
+#define LOAD_POSITION(array, i) vec3(array[3 * (i)], array[3 * (i) + 1], array[3 * (i) + 2])
+#define STORE_POSITION(array, i, value) { int o_ = 3 * (i); vec3 v_ = (value); array[o_] = v_.x; array[o_ + 1] = v_.y; array[o_ + 2] = v_.z; }
+#else
+#define POSITION_ARRAY(name) vec4 name[]
+#define LOAD_POSITION(array, i) (array[i].xyz)
+#define STORE_POSITION(array, i, value) { array[i] = vec4((value), 0.0); }
+#endif
+
+#if defined(CLOTH_HALF_VELOCITY)
+#define VELOCITY_ARRAY(name) uvec2 name[]
+#define LOAD_VELOCITY(array, i) vec3(unpackHalf2x16(array[i].x), unpackHalf2x16(array[i].y).x)
+#define STORE_VELOCITY(array, i, value) { vec3 v_ = (value); array[i] = uvec2(packHalf2x16(v_.xy), packHalf2x16(vec2(v_.z, 0.0))); }
+#else
+#define VELOCITY_ARRAY(name) POSITION_ARRAY(name)
+#define LOAD_VELOCITY(array, i) LOAD_POSITION(array, i)
+#define STORE_VELOCITY(array, i, value) STORE_POSITION(array, i, value)
+#endif
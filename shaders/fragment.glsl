@@ -3,17 +3,30 @@
 in vec3 vNormal;
 in vec3 vWorldPos;
 in vec4 vLightSpacePos;
+flat in uint vMaterialIndex;
+
+layout (std140) uniform FrameUniforms {
+    mat4 uView;
+    mat4 uProj;
+    mat4 uLightSpace;
+    vec4 uCameraPos;
+    vec4 uLightDir;
+    vec4 uPointLightPos;
+    vec4 uPointLightColor;  // a: intensity
+    vec4 uLighting;         // x: ambient strength
+};
+
+// Mirrors RenderUniforms::kMaxMaterials and MaterialData.
+#define MAX_MATERIALS 64
+struct Material {
+    vec4 baseColorSpecular;
+    vec4 shininess;
+};
+layout (std140) uniform MaterialUniforms {
+    Material uMaterials[MAX_MATERIALS];
+};
 
-uniform vec3 uLightDir;
-uniform vec3 uBaseColor;
-uniform vec3 uCameraPos;
-uniform float uSpecularStrength;
-uniform float uShininess;
 uniform sampler2D uShadowMap;
-uniform vec3 uPointLightPos;
-uniform vec3 uPointLightColor;
-uniform float uPointLightIntensity;
-uniform float uAmbientStrength;
 
 out vec4 fragColor;
 
@@ -41,29 +54,35 @@ float computeShadow(vec4 lightSpacePos, vec3 normal, vec3 lightDir) {
 }
 
 void main() {
+    Material material = uMaterials[vMaterialIndex];
+    vec3 baseColor = material.baseColorSpecular.rgb;
+    float specularStrength = material.baseColorSpecular.a;
+    float shininess = material.shininess.x;
+    float pointLightIntensity = uPointLightColor.a;
+    vec3 pointLightColor = uPointLightColor.rgb;
     vec3 n = normalize(vNormal);
-    vec3 v = normalize(uCameraPos - vWorldPos);
+    vec3 v = normalize(uCameraPos.xyz - vWorldPos);
 
-    vec3 dirL = normalize(uLightDir);
+    vec3 dirL = normalize(uLightDir.xyz);
     vec3 dirR = reflect(-dirL, n);
     float dirDiffuseTerm = max(dot(n, dirL), 0.0);
-    float dirSpecTerm = pow(max(dot(v, dirR), 0.0), uShininess);
+    float dirSpecTerm = pow(max(dot(v, dirR), 0.0), shininess);
     float shadow = computeShadow(vLightSpacePos, n, dirL);
 
-    vec3 pointLVec = uPointLightPos - vWorldPos;
+    vec3 pointLVec = uPointLightPos.xyz - vWorldPos;
     float pointDistance = length(pointLVec);
     vec3 pointL = pointLVec / max(pointDistance, 0.0001);
     float attenuation = 1.0 / (1.0 + 0.14 * pointDistance + 0.07 * pointDistance * pointDistance);
     float pointDiffuseTerm = max(dot(n, pointL), 0.0);
     vec3 pointR = reflect(-pointL, n);
-    float pointSpecTerm = pow(max(dot(v, pointR), 0.0), uShininess) * attenuation * uPointLightIntensity;
+    float pointSpecTerm = pow(max(dot(v, pointR), 0.0), shininess) * attenuation * pointLightIntensity;
 
-    vec3 ambient = uAmbientStrength * uBaseColor;
-    vec3 dirDiffuse = 0.85 * dirDiffuseTerm * uBaseColor * (1.0 - shadow);
-    vec3 dirSpecular = uSpecularStrength * dirSpecTerm * vec3(1.0) * (1.0 - shadow);
+    vec3 ambient = uLighting.x * baseColor;
+    vec3 dirDiffuse = 0.85 * dirDiffuseTerm * baseColor * (1.0 - shadow);
+    vec3 dirSpecular = specularStrength * dirSpecTerm * vec3(1.0) * (1.0 - shadow);
 
-    vec3 pointDiffuse = pointDiffuseTerm * uBaseColor * uPointLightColor * attenuation * uPointLightIntensity;
-    vec3 pointSpecular = uSpecularStrength * pointSpecTerm * uPointLightColor;
+    vec3 pointDiffuse = pointDiffuseTerm * baseColor * pointLightColor * attenuation * pointLightIntensity;
+    vec3 pointSpecular = specularStrength * pointSpecTerm * pointLightColor;
 
     vec3 color = ambient + dirDiffuse + dirSpecular + pointDiffuse + pointSpecular;
     fragColor = vec4(color, 1.0);
@@ -1,10 +1,19 @@
 #version 330 core
 
 layout (location = 0) in vec3 aPosition;
+layout (location = 2) in mat4 aModel;
 
-uniform mat4 uModel;
-uniform mat4 uLightSpace;
+layout (std140) uniform FrameUniforms {
+    mat4 uView;
+    mat4 uProj;
+    mat4 uLightSpace;
+    vec4 uCameraPos;
+    vec4 uLightDir;
+    vec4 uPointLightPos;
+    vec4 uPointLightColor;  // a: intensity
+    vec4 uLighting;         // x: ambient strength
+};
 
 void main() {
-    gl_Position = uLightSpace * uModel * vec4(aPosition, 1.0);
+    gl_Position = uLightSpace * aModel * vec4(aPosition, 1.0);
 }
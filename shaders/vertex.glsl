@@ -1,22 +1,43 @@
 #version 330 core
 
 layout (location = 0) in vec3 aPosition;
-layout (location = 1) in vec3 aNormal;
+layout (location = 1) in vec2 aNormalOct;
+// Per instance (MeshInstance in Mesh.h); the cloth supplies them as generic attribute values.
+layout (location = 2) in mat4 aModel;
+layout (location = 6) in mat3 aNormalMatrix;
+layout (location = 9) in uint aMaterialIndex;
 
-uniform mat4 uModel;
-uniform mat4 uView;
-uniform mat4 uProj;
-uniform mat4 uLightSpace;
+// Shared with fragment.glsl and shadow_depth_vertex.glsl; FrameUniformData in RenderUniforms.h.
+layout (std140) uniform FrameUniforms {
+    mat4 uView;
+    mat4 uProj;
+    mat4 uLightSpace;
+    vec4 uCameraPos;
+    vec4 uLightDir;
+    vec4 uPointLightPos;
+    vec4 uPointLightColor;  // a: intensity
+    vec4 uLighting;         // x: ambient strength
+};
 
 out vec3 vNormal;
 out vec3 vWorldPos;
 out vec4 vLightSpacePos;
+flat out uint vMaterialIndex;
+
+// Inverse of packOctahedralNormal (Geometry.h).
+vec3 decodeOctahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+    return normalize(n);
+}
 
 void main() {
-    vec4 worldPos = uModel * vec4(aPosition, 1.0);
+    vec4 worldPos = aModel * vec4(aPosition, 1.0);
     vWorldPos = worldPos.xyz;
-    vNormal = mat3(transpose(inverse(uModel))) * aNormal;
+    vNormal = aNormalMatrix * decodeOctahedral(aNormalOct);
     vLightSpacePos = uLightSpace * worldPos;
+    vMaterialIndex = aMaterialIndex;
 
     gl_Position = uProj * uView * worldPos;
 }
@@ -0,0 +1,157 @@
+#include "AsyncReadback.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include <GL/glew.h>
+
+AsyncReadback::AsyncReadback(std::size_t bytes, std::size_t depth)
+    : m_bytes(bytes),
+      m_buffer(0),
+      m_mapped(nullptr),
+      m_slots(depth, Slot{nullptr, 0}),
+      m_nextSlot(0),
+      m_serial(0),
+      m_snapshot(bytes, 0),
+      m_snapshotSerial(0),
+      m_hasSnapshot(false) {
+    if (bytes == 0 || depth == 0) {
+        throw std::runtime_error("AsyncReadback requires a non-empty range and at least one slot");
+    }
+
+    const GLsizeiptr ringBytes = static_cast<GLsizeiptr>(bytes * depth);
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+    if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) {
+        const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, ringBytes, nullptr, flags | GL_CLIENT_STORAGE_BIT);
+        m_mapped = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, ringBytes, flags));
+    }
+    if (m_mapped == nullptr) {
+        glBufferData(GL_COPY_WRITE_BUFFER, ringBytes, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+AsyncReadback::~AsyncReadback() {
+    for (Slot& slot : m_slots) {
+        releaseSlot(slot);
+    }
+    if (m_buffer != 0) {
+        if (m_mapped != nullptr) {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &m_buffer);
+    }
+}
+
+bool AsyncReadback::enqueue(unsigned int sourceBuffer, std::size_t sourceOffset) {
+    poll();
+
+    Slot& slot = m_slots[m_nextSlot];
+    if (slot.fence != nullptr) {
+        return false;
+    }
+
+    glBindBuffer(GL_COPY_READ_BUFFER, sourceBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+    glCopyBufferSubData(
+        GL_COPY_READ_BUFFER,
+        GL_COPY_WRITE_BUFFER,
+        static_cast<GLintptr>(sourceOffset),
+        static_cast<GLintptr>(m_nextSlot * m_bytes),
+        static_cast<GLsizeiptr>(m_bytes));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.serial = ++m_serial;
+    m_nextSlot = (m_nextSlot + 1) % m_slots.size();
+    return true;
+}
+
+void AsyncReadback::poll() {
+    // Fences signal in submission order, so keep the newest finished slot and free every finished one.
+    std::size_t newest = m_slots.size();
+    for (std::size_t i = 0; i < m_slots.size(); ++i) {
+        Slot& slot = m_slots[i];
+        if (slot.fence == nullptr) {
+            continue;
+        }
+        const GLenum status = glClientWaitSync(static_cast<GLsync>(slot.fence), 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            continue;
+        }
+        glDeleteSync(static_cast<GLsync>(slot.fence));
+        slot.fence = nullptr;
+        if (slot.serial > m_snapshotSerial && (newest == m_slots.size() || slot.serial > m_slots[newest].serial)) {
+            newest = i;
+        }
+    }
+    if (newest == m_slots.size()) {
+        return;
+    }
+
+    const std::size_t offset = newest * m_bytes;
+    if (m_mapped != nullptr) {
+        std::memcpy(m_snapshot.data(), m_mapped + offset, m_bytes);
+    } else {
+        // The copy has finished, so this does not wait on the GPU.
+        glBindBuffer(GL_COPY_READ_BUFFER, m_buffer);
+        glGetBufferSubData(
+            GL_COPY_READ_BUFFER,
+            static_cast<GLintptr>(offset),
+            static_cast<GLsizeiptr>(m_bytes),
+            m_snapshot.data());
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+    m_snapshotSerial = m_slots[newest].serial;
+    m_hasSnapshot = true;
+}
+
+void AsyncReadback::readNow(unsigned int sourceBuffer, std::size_t sourceOffset) {
+    glBindBuffer(GL_COPY_READ_BUFFER, sourceBuffer);
+    glGetBufferSubData(
+        GL_COPY_READ_BUFFER,
+        static_cast<GLintptr>(sourceOffset),
+        static_cast<GLsizeiptr>(m_bytes),
+        m_snapshot.data());
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+    // Anything still in flight is older than this read.
+    m_snapshotSerial = ++m_serial;
+    m_hasSnapshot = true;
+}
+
+void AsyncReadback::discard() {
+    for (Slot& slot : m_slots) {
+        releaseSlot(slot);
+    }
+    m_snapshotSerial = ++m_serial;
+    m_hasSnapshot = false;
+}
+
+bool AsyncReadback::hasSnapshot() const {
+    return m_hasSnapshot;
+}
+
+const void* AsyncReadback::snapshot() const {
+    return m_snapshot.data();
+}
+
+std::uint64_t AsyncReadback::snapshotSerial() const {
+    return m_snapshotSerial;
+}
+
+std::size_t AsyncReadback::size() const {
+    return m_bytes;
+}
+
+void AsyncReadback::releaseSlot(Slot& slot) {
+    if (slot.fence != nullptr) {
+        glDeleteSync(static_cast<GLsync>(slot.fence));
+        slot.fence = nullptr;
+    }
+}
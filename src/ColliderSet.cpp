@@ -0,0 +1,480 @@
+#include "ColliderSet.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "Geometry.h"
+
+namespace {
+constexpr std::uint32_t kCollidersPerLeaf = 2;
+constexpr std::uint32_t kTrianglesPerLeaf = 4;
+constexpr int kMaxStackDepth = 64;
+
+bool overlaps(const glm::vec3& aMin, const glm::vec3& aMax, const glm::vec3& bMin, const glm::vec3& bMax) {
+    return aMin.x <= bMax.x && aMax.x >= bMin.x && aMin.y <= bMax.y && aMax.y >= bMin.y && aMin.z <= bMax.z &&
+           aMax.z >= bMin.z;
+}
+
+// Pushes `position` to `surface + normal * offset` and removes the approaching normal velocity,
+// with Coulomb-style friction proportional to the removed normal speed.
+void applyContact(glm::vec3& position, glm::vec3& velocity, const glm::vec3& projected, const glm::vec3& normal, float friction) {
+    position = projected;
+    const float vn = glm::dot(velocity, normal);
+    if (vn >= 0.0f) {
+        return;
+    }
+    const glm::vec3 tangential = velocity - vn * normal;
+    const float tangentialSpeed = glm::length(tangential);
+    const float scale = tangentialSpeed > 1e-6f ? std::max(0.0f, 1.0f - friction * (-vn) / tangentialSpeed) : 0.0f;
+    velocity = tangential * scale;
+}
+}  // namespace
+
+void ColliderSet::addSphere(const glm::vec3& center, float radius) {
+    Collider collider{};
+    collider.shape = ColliderShape::Sphere;
+    collider.center = center;
+    collider.radius = radius;
+    collider.boundsMin = center - glm::vec3(radius);
+    collider.boundsMax = center + glm::vec3(radius);
+    collider.mesh = -1;
+    m_colliders.push_back(collider);
+    m_built = false;
+}
+
+void ColliderSet::addCapsule(const glm::vec3& a, const glm::vec3& b, float radius) {
+    Collider collider{};
+    collider.shape = ColliderShape::Capsule;
+    collider.center = a;
+    collider.endB = b;
+    collider.radius = radius;
+    collider.boundsMin = glm::min(a, b) - glm::vec3(radius);
+    collider.boundsMax = glm::max(a, b) + glm::vec3(radius);
+    collider.mesh = -1;
+    m_colliders.push_back(collider);
+    m_built = false;
+}
+
+void ColliderSet::addBox(const glm::mat4& unitCubeModel) {
+    Collider collider{};
+    collider.shape = ColliderShape::Box;
+    collider.center = glm::vec3(unitCubeModel[3]);
+    glm::vec3 extent(0.0f);
+    for (int axis = 0; axis < 3; ++axis) {
+        const glm::vec3 column = glm::vec3(unitCubeModel[axis]);
+        const float length = glm::length(column);
+        collider.halfExtents[axis] = 0.5f * length;
+        collider.axes[axis] = length > 1e-6f ? column / length : glm::vec3(0.0f);
+        extent += glm::abs(column) * 0.5f;
+    }
+    collider.boundsMin = collider.center - extent;
+    collider.boundsMax = collider.center + extent;
+    collider.mesh = -1;
+    m_colliders.push_back(collider);
+    m_built = false;
+}
+
+void ColliderSet::addTriangleMesh(const ObjMeshData& mesh, const glm::mat4& model) {
+    if (mesh.indices.size() < 3) {
+        throw std::runtime_error("Triangle mesh collider needs at least one triangle");
+    }
+
+    TriangleMesh tri;
+    tri.corners.reserve(mesh.indices.size());
+    for (const unsigned int index : mesh.indices) {
+        tri.corners.push_back(glm::vec3(model * glm::vec4(mesh.vertices[index].position, 1.0f)));
+    }
+
+    const std::uint32_t triangleCount = static_cast<std::uint32_t>(tri.corners.size() / 3);
+    std::vector<glm::vec3> triMin(triangleCount);
+    std::vector<glm::vec3> triMax(triangleCount);
+    tri.order.resize(triangleCount);
+    for (std::uint32_t t = 0; t < triangleCount; ++t) {
+        const glm::vec3& a = tri.corners[3 * t + 0];
+        const glm::vec3& b = tri.corners[3 * t + 1];
+        const glm::vec3& c = tri.corners[3 * t + 2];
+        triMin[t] = glm::min(a, glm::min(b, c));
+        triMax[t] = glm::max(a, glm::max(b, c));
+        tri.order[t] = t;
+    }
+    buildBvh(tri.nodes, tri.order, triMin, triMax, 0, triangleCount, kTrianglesPerLeaf);
+
+    Collider collider{};
+    collider.shape = ColliderShape::TriangleMesh;
+    collider.boundsMin = tri.nodes.front().boundsMin;
+    collider.boundsMax = tri.nodes.front().boundsMax;
+    collider.mesh = static_cast<int>(m_meshes.size());
+    m_meshes.push_back(std::move(tri));
+    m_colliders.push_back(collider);
+    m_built = false;
+}
+
+void ColliderSet::addSdf(std::shared_ptr<const SdfGrid> sdf, const glm::mat4& model) {
+    if (!sdf) {
+        throw std::runtime_error("SDF collider needs a grid");
+    }
+
+    Collider collider{};
+    collider.shape = ColliderShape::Sdf;
+    collider.center = glm::vec3(model[3]);
+    collider.scale = glm::length(glm::vec3(model[0]));
+    for (int axis = 0; axis < 3; ++axis) {
+        const glm::vec3 column = glm::vec3(model[axis]);
+        const float length = glm::length(column);
+        if (collider.scale <= 1e-6f || std::abs(length - collider.scale) > 1e-4f * collider.scale) {
+            throw std::runtime_error("SDF collider transform must use a uniform, non-zero scale");
+        }
+        collider.axes[axis] = column / length;
+    }
+
+    // World bounds of the transformed lattice box.
+    const glm::vec3 gridMin = sdf->origin();
+    const glm::vec3 gridMax = sdf->boundsMax();
+    collider.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    collider.boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+    for (int corner = 0; corner < 8; ++corner) {
+        const glm::vec3 local(
+            (corner & 1) != 0 ? gridMax.x : gridMin.x,
+            (corner & 2) != 0 ? gridMax.y : gridMin.y,
+            (corner & 4) != 0 ? gridMax.z : gridMin.z);
+        const glm::vec3 world = glm::vec3(model * glm::vec4(local, 1.0f));
+        collider.boundsMin = glm::min(collider.boundsMin, world);
+        collider.boundsMax = glm::max(collider.boundsMax, world);
+    }
+    collider.mesh = -1;
+    collider.sdf = std::move(sdf);
+    m_colliders.push_back(std::move(collider));
+    m_built = false;
+}
+
+void ColliderSet::clear() {
+    m_colliders.clear();
+    m_meshes.clear();
+    m_order.clear();
+    m_nodes.clear();
+    m_built = false;
+}
+
+void ColliderSet::build() {
+    m_nodes.clear();
+    m_order.resize(m_colliders.size());
+    std::vector<glm::vec3> itemMin(m_colliders.size());
+    std::vector<glm::vec3> itemMax(m_colliders.size());
+    for (std::size_t i = 0; i < m_colliders.size(); ++i) {
+        itemMin[i] = m_colliders[i].boundsMin;
+        itemMax[i] = m_colliders[i].boundsMax;
+        m_order[i] = static_cast<std::uint32_t>(i);
+    }
+    if (!m_colliders.empty()) {
+        buildBvh(m_nodes, m_order, itemMin, itemMax, 0, static_cast<std::uint32_t>(m_colliders.size()), kCollidersPerLeaf);
+    }
+    m_built = true;
+}
+
+std::size_t ColliderSet::size() const {
+    return m_colliders.size();
+}
+
+bool ColliderSet::empty() const {
+    return m_colliders.empty();
+}
+
+bool ColliderSet::isBuilt() const {
+    return m_built;
+}
+
+int ColliderSet::buildBvh(
+    std::vector<BvhNode>& nodes,
+    std::vector<std::uint32_t>& order,
+    const std::vector<glm::vec3>& itemMin,
+    const std::vector<glm::vec3>& itemMax,
+    std::uint32_t first,
+    std::uint32_t count,
+    std::uint32_t leafSize) {
+    const int nodeIndex = static_cast<int>(nodes.size());
+    nodes.push_back(BvhNode{glm::vec3(0.0f), glm::vec3(0.0f), first, count, -1, -1});
+
+    glm::vec3 bmin(std::numeric_limits<float>::max());
+    glm::vec3 bmax(-std::numeric_limits<float>::max());
+    glm::vec3 centroidMin(std::numeric_limits<float>::max());
+    glm::vec3 centroidMax(-std::numeric_limits<float>::max());
+    for (std::uint32_t i = first; i < first + count; ++i) {
+        const std::uint32_t item = order[i];
+        bmin = glm::min(bmin, itemMin[item]);
+        bmax = glm::max(bmax, itemMax[item]);
+        const glm::vec3 centroid = 0.5f * (itemMin[item] + itemMax[item]);
+        centroidMin = glm::min(centroidMin, centroid);
+        centroidMax = glm::max(centroidMax, centroid);
+    }
+    nodes[static_cast<std::size_t>(nodeIndex)].boundsMin = bmin;
+    nodes[static_cast<std::size_t>(nodeIndex)].boundsMax = bmax;
+
+    if (count <= leafSize) {
+        return nodeIndex;
+    }
+
+    const glm::vec3 spread = centroidMax - centroidMin;
+    int axis = 0;
+    if (spread.y > spread.x && spread.y >= spread.z) {
+        axis = 1;
+    } else if (spread.z > spread.x && spread.z > spread.y) {
+        axis = 2;
+    }
+
+    const std::uint32_t half = count / 2;
+    std::nth_element(
+        order.begin() + first,
+        order.begin() + first + half,
+        order.begin() + first + count,
+        [&](std::uint32_t a, std::uint32_t b) {
+            return itemMin[a][axis] + itemMax[a][axis] < itemMin[b][axis] + itemMax[b][axis];
+        });
+
+    const int left = buildBvh(nodes, order, itemMin, itemMax, first, half, leafSize);
+    const int right = buildBvh(nodes, order, itemMin, itemMax, first + half, count - half, leafSize);
+    BvhNode& node = nodes[static_cast<std::size_t>(nodeIndex)];
+    node.left = left;
+    node.right = right;
+    node.count = 0;
+    return nodeIndex;
+}
+
+void ColliderSet::queryOverlaps(
+    const glm::vec3& boundsMin,
+    const glm::vec3& boundsMax,
+    std::vector<std::uint32_t>& out) const {
+    if (!m_built) {
+        throw std::runtime_error("ColliderSet::build must be called before querying");
+    }
+    if (m_nodes.empty()) {
+        return;
+    }
+
+    int stack[kMaxStackDepth];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const BvhNode& node = m_nodes[static_cast<std::size_t>(stack[--top])];
+        if (!overlaps(node.boundsMin, node.boundsMax, boundsMin, boundsMax)) {
+            continue;
+        }
+        if (node.left >= 0) {
+            stack[top++] = node.left;
+            stack[top++] = node.right;
+            continue;
+        }
+        for (std::uint32_t i = node.first; i < node.first + node.count; ++i) {
+            const std::uint32_t collider = m_order[i];
+            if (overlaps(m_colliders[collider].boundsMin, m_colliders[collider].boundsMax, boundsMin, boundsMax)) {
+                out.push_back(collider);
+            }
+        }
+    }
+}
+
+bool ColliderSet::resolveParticle(
+    std::uint32_t colliderIndex,
+    glm::vec3& position,
+    glm::vec3& velocity,
+    float thickness,
+    float friction) const {
+    const Collider& collider = m_colliders[colliderIndex];
+
+    switch (collider.shape) {
+    case ColliderShape::Sphere:
+    case ColliderShape::Capsule: {
+        const glm::vec3 core = collider.shape == ColliderShape::Sphere
+                                   ? collider.center
+                                   : closestPointOnSegment(position, collider.center, collider.endB);
+        const glm::vec3 d = position - core;
+        const float reach = collider.radius + thickness;
+        const float distSq = glm::dot(d, d);
+        if (distSq >= reach * reach) {
+            return false;
+        }
+        const float dist = std::sqrt(distSq);
+        const glm::vec3 normal = dist > 1e-6f ? d / dist : glm::vec3(0.0f, 1.0f, 0.0f);
+        applyContact(position, velocity, core + normal * reach, normal, friction);
+        return true;
+    }
+    case ColliderShape::Box: {
+        const glm::vec3 d = position - collider.center;
+        const glm::vec3 local(glm::dot(d, collider.axes[0]), glm::dot(d, collider.axes[1]), glm::dot(d, collider.axes[2]));
+        const glm::vec3 clamped = glm::clamp(local, -collider.halfExtents, collider.halfExtents);
+        const glm::vec3 outside = local - clamped;
+        const float outsideSq = glm::dot(outside, outside);
+
+        glm::vec3 localNormal(0.0f);
+        glm::vec3 projectedLocal = local;
+        if (outsideSq > 1e-12f) {
+            if (outsideSq >= thickness * thickness) {
+                return false;
+            }
+            localNormal = outside / std::sqrt(outsideSq);
+            projectedLocal = clamped + localNormal * thickness;
+        } else {
+            // Inside the box: leave through the face with the smallest penetration.
+            int axis = 0;
+            float best = collider.halfExtents.x - std::abs(local.x);
+            for (int a = 1; a < 3; ++a) {
+                const float penetration = collider.halfExtents[a] - std::abs(local[a]);
+                if (penetration < best) {
+                    best = penetration;
+                    axis = a;
+                }
+            }
+            const float side = local[axis] >= 0.0f ? 1.0f : -1.0f;
+            localNormal[axis] = side;
+            projectedLocal[axis] = side * (collider.halfExtents[axis] + thickness);
+        }
+
+        const glm::vec3 projected = collider.center + collider.axes[0] * projectedLocal.x +
+                                    collider.axes[1] * projectedLocal.y + collider.axes[2] * projectedLocal.z;
+        const glm::vec3 normal =
+            collider.axes[0] * localNormal.x + collider.axes[1] * localNormal.y + collider.axes[2] * localNormal.z;
+        applyContact(position, velocity, projected, normal, friction);
+        return true;
+    }
+    case ColliderShape::TriangleMesh: {
+        glm::vec3 projected = position;
+        glm::vec3 normal(0.0f);
+        if (!resolveTriangleMesh(m_meshes[static_cast<std::size_t>(collider.mesh)], projected, normal, thickness)) {
+            return false;
+        }
+        applyContact(position, velocity, projected, normal, friction);
+        return true;
+    }
+    case ColliderShape::Sdf: {
+        const glm::vec3 d = position - collider.center;
+        const glm::vec3 local =
+            glm::vec3(glm::dot(d, collider.axes[0]), glm::dot(d, collider.axes[1]), glm::dot(d, collider.axes[2])) /
+            collider.scale;
+        glm::vec3 gradient(0.0f);
+        if (!collider.sdf->inNarrowBand(local)) {
+            return false;
+        }
+        const float distance = collider.sdf->sample(local, &gradient) * collider.scale;
+        const float gradientLength = glm::length(gradient);
+        if (distance >= thickness || gradientLength <= 1e-6f) {
+            return false;
+        }
+        const glm::vec3 localNormal = gradient / gradientLength;
+        const glm::vec3 normal =
+            collider.axes[0] * localNormal.x + collider.axes[1] * localNormal.y + collider.axes[2] * localNormal.z;
+        applyContact(position, velocity, position + normal * (thickness - distance), normal, friction);
+        return true;
+    }
+    }
+    return false;
+}
+
+bool ColliderSet::resolveTriangleMesh(
+    const TriangleMesh& mesh,
+    glm::vec3& position,
+    glm::vec3& normal,
+    float thickness) const {
+    const glm::vec3 queryMin = position - glm::vec3(thickness);
+    const glm::vec3 queryMax = position + glm::vec3(thickness);
+
+    float bestDistSq = thickness * thickness;
+    std::uint32_t bestTriangle = 0;
+    glm::vec3 bestPoint(0.0f);
+    bool found = false;
+
+    int stack[kMaxStackDepth];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const BvhNode& node = mesh.nodes[static_cast<std::size_t>(stack[--top])];
+        if (!overlaps(node.boundsMin, node.boundsMax, queryMin, queryMax)) {
+            continue;
+        }
+        if (node.left >= 0) {
+            stack[top++] = node.left;
+            stack[top++] = node.right;
+            continue;
+        }
+        for (std::uint32_t i = node.first; i < node.first + node.count; ++i) {
+            const std::uint32_t t = mesh.order[i];
+            const glm::vec3 q =
+                closestPointOnTriangle(position, mesh.corners[3 * t + 0], mesh.corners[3 * t + 1], mesh.corners[3 * t + 2]);
+            const glm::vec3 d = position - q;
+            const float distSq = glm::dot(d, d);
+            if (distSq < bestDistSq) {
+                bestDistSq = distSq;
+                bestTriangle = t;
+                bestPoint = q;
+                found = true;
+            }
+        }
+    }
+
+    if (!found) {
+        return false;
+    }
+
+    const float dist = std::sqrt(bestDistSq);
+    if (dist > 1e-6f) {
+        normal = (position - bestPoint) / dist;
+    } else {
+        const glm::vec3& a = mesh.corners[3 * bestTriangle + 0];
+        const glm::vec3& b = mesh.corners[3 * bestTriangle + 1];
+        const glm::vec3& c = mesh.corners[3 * bestTriangle + 2];
+        normal = glm::normalize(glm::cross(b - a, c - a));
+    }
+    position = bestPoint + normal * thickness;
+    return true;
+}
+
+GpuColliderData ColliderSet::gpuData() const {
+    GpuColliderData data;
+    data.records.reserve(m_colliders.size());
+    for (const Collider& collider : m_colliders) {
+        if (collider.shape == ColliderShape::TriangleMesh) {
+            continue;
+        }
+
+        GpuColliderRecord record{};
+        record.boundsMin = glm::vec4(collider.boundsMin, static_cast<float>(collider.shape));
+        record.boundsMax = glm::vec4(collider.boundsMax, collider.radius);
+        record.center = glm::vec4(collider.center, collider.scale);
+        record.axisX = glm::vec4(0.0f);
+        record.axisY = glm::vec4(0.0f);
+        record.axisZ = glm::vec4(0.0f);
+        record.sdfGrid = glm::vec4(0.0f);
+        record.sdfLayout = glm::uvec4(0u);
+        if (collider.shape == ColliderShape::Capsule) {
+            record.axisX = glm::vec4(collider.endB, 0.0f);
+        } else if (collider.shape == ColliderShape::Box) {
+            record.axisX = glm::vec4(collider.axes[0], collider.halfExtents.x);
+            record.axisY = glm::vec4(collider.axes[1], collider.halfExtents.y);
+            record.axisZ = glm::vec4(collider.axes[2], collider.halfExtents.z);
+        } else if (collider.shape == ColliderShape::Sdf) {
+            const SdfGrid& sdf = *collider.sdf;
+            record.axisX = glm::vec4(collider.axes[0], 0.0f);
+            record.axisY = glm::vec4(collider.axes[1], 0.0f);
+            record.axisZ = glm::vec4(collider.axes[2], 0.0f);
+            record.sdfGrid = glm::vec4(sdf.origin(), sdf.voxelSize());
+            const std::uint32_t tableOffset = static_cast<std::uint32_t>(data.sdfData.size());
+            const std::uint32_t sampleOffset = tableOffset + static_cast<std::uint32_t>(sdf.brickTableSize());
+            record.sdfLayout = glm::uvec4(sdf.brickDims(), tableOffset);
+
+            for (std::size_t b = 0; b < sdf.brickTableSize(); ++b) {
+                const std::int32_t entry = sdf.brickTable()[b];
+                const std::int32_t word =
+                    entry >= 0 ? static_cast<std::int32_t>(sampleOffset + static_cast<std::uint32_t>(entry) * SdfGrid::kSamplesPerBrick)
+                               : entry;
+                data.sdfData.push_back(static_cast<std::uint32_t>(word));
+            }
+            const std::size_t sampleCount = sdf.brickCount() * SdfGrid::kSamplesPerBrick;
+            const std::size_t sampleBegin = data.sdfData.size();
+            data.sdfData.resize(sampleBegin + sampleCount);
+            std::memcpy(data.sdfData.data() + sampleBegin, sdf.samples(), sampleCount * sizeof(float));
+        }
+        data.records.push_back(record);
+    }
+    return data;
+}
@@ -0,0 +1,310 @@
+#include "GpuClothBatch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include <GL/glew.h>
+
+#include "GpuParamsRing.h"
+#include "GpuSimParams.h"
+#include "ProgramCache.h"
+
+namespace {
+constexpr float kBaseGravity = 9.81f;
+constexpr float kMass = 0.1f;
+constexpr float kSpringDamping = 0.8f;
+constexpr float kMaxSpeed = 8.0f;
+constexpr float kGroundY = -1.2f;
+constexpr int kMaxSubsteps = 16;
+constexpr unsigned int kGroupSize = 128;
+constexpr std::size_t kReadbackLatency = 3;
+constexpr std::size_t kParamsFrames = 3;
+
+// Same binding points as GpuPhysicsSolver; both re-establish theirs before dispatching.
+constexpr unsigned int kSimParamsBinding = 0;
+constexpr unsigned int kPosBinding = 0;
+constexpr unsigned int kVelBinding = 2;
+constexpr unsigned int kFixedBinding = 4;
+constexpr unsigned int kHealthBinding = 5;
+constexpr unsigned int kInstanceBinding = 6;  // the batch kernel has no collider or SDF blocks
+constexpr unsigned int kParticleInstanceBinding = 7;
+}  // namespace
+
+GpuClothBatch::GpuClothBatch(const std::vector<GpuClothInstanceDesc>& instances)
+    : m_instances(instances),
+      m_particleCount(0),
+      m_program(0),
+      m_posSsboA(0),
+      m_posSsboB(0),
+      m_velSsboA(0),
+      m_velSsboB(0),
+      m_fixedSsbo(0),
+      m_healthSsbo(0),
+      m_instanceSsbo(0),
+      m_particleInstanceSsbo(0),
+      m_pingPongFlip(false),
+      m_healthSerial(0) {
+    if (instances.empty()) {
+        throw std::runtime_error("GpuClothBatch requires at least one instance");
+    }
+    for (const GpuClothInstanceDesc& desc : instances) {
+        if (desc.rows < 2 || desc.cols < 2) {
+            throw std::runtime_error("GpuClothBatch instances require rows and cols >= 2");
+        }
+        m_records.push_back(makeRecord(desc, m_particleCount));
+        m_particleCount += desc.rows * desc.cols;
+    }
+
+    m_program = ProgramCache::build({{GL_COMPUTE_SHADER, ProgramCache::loadSource("shaders/cloth_batch_step.comp")}});
+
+    glGenBuffers(1, &m_posSsboA);
+    glGenBuffers(1, &m_posSsboB);
+    glGenBuffers(1, &m_velSsboA);
+    glGenBuffers(1, &m_velSsboB);
+    glGenBuffers(1, &m_fixedSsbo);
+    glGenBuffers(1, &m_healthSsbo);
+    glGenBuffers(1, &m_instanceSsbo);
+    glGenBuffers(1, &m_particleInstanceSsbo);
+
+    std::vector<unsigned int> particleInstance;
+    particleInstance.reserve(m_particleCount);
+    for (std::size_t i = 0; i < m_instances.size(); ++i) {
+        const std::size_t count = m_instances[i].rows * m_instances[i].cols;
+        particleInstance.insert(particleInstance.end(), count, static_cast<unsigned int>(i));
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_particleInstanceSsbo);
+    glBufferData(
+        GL_SHADER_STORAGE_BUFFER,
+        static_cast<GLsizeiptr>(particleInstance.size() * sizeof(unsigned int)),
+        particleInstance.data(),
+        GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_instanceSsbo);
+    glBufferData(
+        GL_SHADER_STORAGE_BUFFER,
+        static_cast<GLsizeiptr>(m_records.size() * sizeof(InstanceRecord)),
+        m_records.data(),
+        GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    m_paramsRing = std::make_unique<GpuParamsRing>(kMaxSubsteps, kParamsFrames);
+
+    uploadInitialState();
+    m_healthReadback = std::make_unique<AsyncReadback>(sizeof(unsigned int), kReadbackLatency);
+}
+
+GpuClothBatch::~GpuClothBatch() {
+    const unsigned int buffers[] = {
+        m_posSsboA,
+        m_posSsboB,
+        m_velSsboA,
+        m_velSsboB,
+        m_fixedSsbo,
+        m_healthSsbo,
+        m_instanceSsbo,
+        m_particleInstanceSsbo,
+    };
+    for (const unsigned int buffer : buffers) {
+        if (buffer != 0) {
+            glDeleteBuffers(1, &buffer);
+        }
+    }
+    if (m_program != 0) {
+        glDeleteProgram(m_program);
+    }
+}
+
+void GpuClothBatch::step(float dt) {
+    if (dt <= 0.0f) {
+        return;
+    }
+
+    const float clampedDt = std::min(dt, 1.0f / 30.0f);
+    const float maxSubstep = 1.0f / 240.0f;
+    const int substeps = std::clamp(static_cast<int>(std::ceil(clampedDt / maxSubstep)), 1, kMaxSubsteps);
+    const float h = clampedDt / static_cast<float>(substeps);
+
+    // Material lives in the instance table, so the shared records only carry the integrator constants.
+    GpuSimParams params{};
+    params.numParticles = static_cast<int>(m_particleCount);
+    params.draggedIndex = -1;
+    params.dt = h;
+    params.mass = kMass;
+    params.springDamping = kSpringDamping;
+    params.maxSpeed = kMaxSpeed;
+    params.groundY = kGroundY;
+    m_paramsRing->beginFrame();
+    bool flip = m_pingPongFlip;
+    for (int i = 0; i < substeps; ++i) {
+        params.readIndex = flip ? 1 : 0;
+        m_paramsRing->write(static_cast<std::size_t>(i), params);
+        flip = !flip;
+    }
+    m_paramsRing->upload(static_cast<std::size_t>(substeps));
+
+    const unsigned int zero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_healthSsbo);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    bindBuffers();
+    glUseProgram(m_program);
+    const unsigned int groups = static_cast<unsigned int>((m_particleCount + kGroupSize - 1) / kGroupSize);
+    for (int i = 0; i < substeps; ++i) {
+        m_paramsRing->bind(kSimParamsBinding, static_cast<std::size_t>(i));
+        glDispatchCompute(groups, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        m_pingPongFlip = !m_pingPongFlip;
+    }
+    glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    m_paramsRing->endFrame();
+
+    m_healthReadback->enqueue(m_healthSsbo);
+    m_healthReadback->poll();
+    if (m_healthReadback->hasSnapshot() && m_healthReadback->snapshotSerial() != m_healthSerial) {
+        m_healthSerial = m_healthReadback->snapshotSerial();
+        unsigned int flag = 0;
+        std::memcpy(&flag, m_healthReadback->snapshot(), sizeof(flag));
+        if (flag != 0) {
+            reset();
+        }
+    }
+}
+
+void GpuClothBatch::reset() {
+    m_pingPongFlip = false;
+    uploadInitialState();
+    m_healthReadback->discard();
+    m_healthSerial = m_healthReadback->snapshotSerial();
+}
+
+void GpuClothBatch::setInstanceMaterial(
+    std::size_t instance,
+    float stiffness,
+    float damping,
+    float gravityScale,
+    float windStrength) {
+    if (instance >= m_instances.size()) {
+        throw std::runtime_error("GpuClothBatch instance out of range");
+    }
+    GpuClothInstanceDesc& desc = m_instances[instance];
+    desc.stiffness = std::clamp(stiffness, 10.0f, 1200.0f);
+    desc.damping = std::clamp(damping, 0.0f, 5.0f);
+    desc.gravityScale = std::clamp(gravityScale, 0.0f, 3.0f);
+    desc.windStrength = std::clamp(windStrength, -8.0f, 8.0f);
+    m_records[instance] = makeRecord(desc, particleOffset(instance));
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_instanceSsbo);
+    glBufferSubData(
+        GL_SHADER_STORAGE_BUFFER,
+        static_cast<GLintptr>(instance * sizeof(InstanceRecord)),
+        sizeof(InstanceRecord),
+        &m_records[instance]);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+std::size_t GpuClothBatch::instanceCount() const {
+    return m_instances.size();
+}
+
+std::size_t GpuClothBatch::particleCount() const {
+    return m_particleCount;
+}
+
+std::size_t GpuClothBatch::particleOffset(std::size_t instance) const {
+    return static_cast<std::size_t>(m_records.at(instance).grid.x);
+}
+
+unsigned int GpuClothBatch::positionBuffer() const {
+    return m_pingPongFlip ? m_posSsboB : m_posSsboA;
+}
+
+std::vector<glm::vec3> GpuClothBatch::readPositions(std::size_t instance) const {
+    const GpuClothInstanceDesc& desc = m_instances.at(instance);
+    std::vector<glm::vec4> pos4(desc.rows * desc.cols);
+    glBindBuffer(GL_COPY_READ_BUFFER, positionBuffer());
+    glGetBufferSubData(
+        GL_COPY_READ_BUFFER,
+        static_cast<GLintptr>(particleOffset(instance) * sizeof(glm::vec4)),
+        static_cast<GLsizeiptr>(pos4.size() * sizeof(glm::vec4)),
+        pos4.data());
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+    std::vector<glm::vec3> positions(pos4.size());
+    for (std::size_t i = 0; i < pos4.size(); ++i) {
+        positions[i] = glm::vec3(pos4[i]);
+    }
+    return positions;
+}
+
+void GpuClothBatch::uploadInitialState() {
+    std::vector<glm::vec4> pos4(m_particleCount, glm::vec4(0.0f));
+    std::vector<int> fixedFlags(m_particleCount, 0);
+    std::size_t first = 0;
+    for (const GpuClothInstanceDesc& desc : m_instances) {
+        const float halfWidth = 0.5f * static_cast<float>(desc.cols - 1) * desc.spacing;
+        const float halfHeight = 0.5f * static_cast<float>(desc.rows - 1) * desc.spacing;
+        for (std::size_t r = 0; r < desc.rows; ++r) {
+            for (std::size_t c = 0; c < desc.cols; ++c) {
+                const glm::vec3 offset(
+                    static_cast<float>(c) * desc.spacing - halfWidth,
+                    0.0f,
+                    static_cast<float>(r) * desc.spacing - halfHeight);
+                pos4[first + r * desc.cols + c] = glm::vec4(desc.center + offset, 0.0f);
+            }
+        }
+        fixedFlags[first] = 1;
+        fixedFlags[first + desc.cols - 1] = 1;
+        first += desc.rows * desc.cols;
+    }
+    const std::vector<glm::vec4> vel4(m_particleCount, glm::vec4(0.0f));
+    const GLsizeiptr particleBytes = static_cast<GLsizeiptr>(m_particleCount * sizeof(glm::vec4));
+
+    const unsigned int posBuffers[] = {m_posSsboA, m_posSsboB};
+    for (const unsigned int buffer : posBuffers) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, particleBytes, pos4.data(), GL_DYNAMIC_DRAW);
+    }
+    const unsigned int velBuffers[] = {m_velSsboA, m_velSsboB};
+    for (const unsigned int buffer : velBuffers) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, particleBytes, vel4.data(), GL_DYNAMIC_DRAW);
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_fixedSsbo);
+    glBufferData(
+        GL_SHADER_STORAGE_BUFFER,
+        static_cast<GLsizeiptr>(fixedFlags.size() * sizeof(int)),
+        fixedFlags.data(),
+        GL_STATIC_DRAW);
+
+    const unsigned int healthInit = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_healthSsbo);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int), &healthInit, GL_DYNAMIC_READ);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void GpuClothBatch::bindBuffers() const {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kPosBinding, m_posSsboA);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kPosBinding + 1, m_posSsboB);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kVelBinding, m_velSsboA);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kVelBinding + 1, m_velSsboB);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kFixedBinding, m_fixedSsbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kHealthBinding, m_healthSsbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kInstanceBinding, m_instanceSsbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kParticleInstanceBinding, m_particleInstanceSsbo);
+}
+
+GpuClothBatch::InstanceRecord GpuClothBatch::makeRecord(const GpuClothInstanceDesc& desc, std::size_t firstParticle) {
+    InstanceRecord record{};
+    record.grid = glm::ivec4(
+        static_cast<int>(firstParticle),
+        static_cast<int>(desc.rows),
+        static_cast<int>(desc.cols),
+        0);
+    record.material = glm::vec4(desc.spacing, desc.stiffness, desc.damping, 0.0f);
+    record.gravity = glm::vec4(0.0f, -kBaseGravity * desc.gravityScale, 0.0f, 0.0f);
+    record.wind = glm::vec4(desc.windStrength, 0.0f, 0.0f, 0.0f);
+    return record;
+}
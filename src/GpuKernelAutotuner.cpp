@@ -0,0 +1,225 @@
+#include "GpuKernelAutotuner.h"
+
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <GL/glew.h>
+
+namespace {
+constexpr int kFileVersion = 1;
+constexpr float kStepDt = 1.0f / 60.0f;
+// The first steps pay for driver-side pipeline warm-up, so they stay out of the measurement.
+constexpr int kWarmupSteps = 4;
+constexpr int kTimedSteps = 24;
+
+struct GroupShape {
+    unsigned int x;
+    unsigned int y;
+};
+
+// 1D shapes index particles linearly; 2D shapes tile the grid as (col, row).
+constexpr GroupShape kGroupShapes[] = {
+    {32, 1},
+    {64, 1},
+    {128, 1},
+    {256, 1},
+    {512, 1},
+    {8, 8},
+    {16, 8},
+    {16, 16},
+    {32, 8},
+};
+
+constexpr GpuParticleLayout kLayouts[] = {
+    GpuParticleLayout::Vec4,
+    GpuParticleLayout::Packed,
+    GpuParticleLayout::PackedHalfVelocity,
+};
+
+std::string glString(GLenum name) {
+    const char* value = reinterpret_cast<const char*>(glGetString(name));
+    return value != nullptr ? value : "";
+}
+
+bool shapeSupported(const GroupShape& shape) {
+    int maxInvocations = 0;
+    int maxX = 0;
+    int maxY = 0;
+    glGetIntegerv(GL_MAX_COMPUTE_WORK_GROUP_INVOCATIONS, &maxInvocations);
+    glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, 0, &maxX);
+    glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, 1, &maxY);
+    return shape.x * shape.y <= static_cast<unsigned int>(maxInvocations) &&
+           shape.x <= static_cast<unsigned int>(maxX) && shape.y <= static_cast<unsigned int>(maxY);
+}
+
+std::vector<std::string> readLines(const std::string& path) {
+    std::vector<std::string> lines;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+}  // namespace
+
+GpuKernelConfig GpuKernelAutotuner::tune(
+    std::size_t rows,
+    std::size_t cols,
+    float spacing,
+    std::shared_ptr<const ColliderSet> colliders) {
+    GpuKernelConfig best;
+    best.stepMilliseconds = std::numeric_limits<double>::infinity();
+
+    for (const GpuParticleLayout layout : kLayouts) {
+        std::unique_ptr<GpuPhysicsSolver> solver;
+        try {
+            solver = std::make_unique<GpuPhysicsSolver>(rows, cols, spacing, layout);
+            solver->setColliders(colliders);
+        } catch (const std::runtime_error&) {
+            continue;
+        }
+
+        for (const GroupShape& shape : kGroupShapes) {
+            if (!shapeSupported(shape)) {
+                continue;
+            }
+            GpuStepKernelOptions options;
+            options.groupSizeX = shape.x;
+            options.groupSizeY = shape.y;
+
+            double milliseconds = 0.0;
+            try {
+                solver->setStepKernelOptions(options);
+                solver->reset();
+                milliseconds = timeSteps(*solver);
+            } catch (const std::runtime_error&) {
+                // The driver refused this variant (e.g. shared memory or register limits); try the next one.
+                continue;
+            }
+            if (milliseconds < best.stepMilliseconds) {
+                best.layout = layout;
+                best.options = options;
+                best.stepMilliseconds = milliseconds;
+            }
+        }
+    }
+
+    if (best.stepMilliseconds == std::numeric_limits<double>::infinity()) {
+        throw std::runtime_error("GpuKernelAutotuner found no step kernel configuration that runs on this device");
+    }
+    return best;
+}
+
+bool GpuKernelAutotuner::load(const std::string& path, std::size_t rows, std::size_t cols, GpuKernelConfig& config) {
+    const std::string key = entryKey(rows, cols);
+    for (const std::string& line : readLines(path)) {
+        const std::size_t tab = line.find('\t');
+        if (tab == std::string::npos || line.compare(tab + 1, std::string::npos, key) != 0) {
+            continue;
+        }
+
+        std::istringstream fields(line.substr(0, tab));
+        int version = 0;
+        int layout = 0;
+        GpuKernelConfig parsed;
+        fields >> version >> layout >> parsed.options.groupSizeX >> parsed.options.groupSizeY;
+        fields >> parsed.stepMilliseconds;
+        if (!fields || version != kFileVersion || layout < 0 || layout > 2) {
+            return false;
+        }
+        // A file written on another driver may hold shapes this device cannot launch.
+        const GroupShape shape{parsed.options.groupSizeX, parsed.options.groupSizeY};
+        if (shape.x == 0 || shape.y == 0 || !shapeSupported(shape)) {
+            return false;
+        }
+        parsed.layout = static_cast<GpuParticleLayout>(layout);
+        config = parsed;
+        return true;
+    }
+    return false;
+}
+
+// One entry per line: "<version> <layout> <groupX> <groupY> <ms>\t<rows>x<cols>|<vendor>|<renderer>|<version>".
+void GpuKernelAutotuner::save(
+    const std::string& path,
+    std::size_t rows,
+    std::size_t cols,
+    const GpuKernelConfig& config) {
+    const std::string key = entryKey(rows, cols);
+    std::vector<std::string> lines;
+    for (const std::string& line : readLines(path)) {
+        const std::size_t tab = line.find('\t');
+        if (tab != std::string::npos && line.compare(tab + 1, std::string::npos, key) != 0) {
+            lines.push_back(line);
+        }
+    }
+    std::ostringstream entry;
+    entry << kFileVersion << ' ' << static_cast<int>(config.layout) << ' ' << config.options.groupSizeX << ' '
+          << config.options.groupSizeY << ' ' << config.stepMilliseconds << '\t' << key;
+    lines.push_back(entry.str());
+
+    const std::filesystem::path target(path);
+    std::error_code ec;
+    if (target.has_parent_path()) {
+        std::filesystem::create_directories(target.parent_path(), ec);
+    }
+
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("Unable to write autotune results: " + temporary);
+        }
+        for (const std::string& line : lines) {
+            file << line << '\n';
+        }
+        if (!file) {
+            throw std::runtime_error("Unable to write autotune results: " + temporary);
+        }
+    }
+    std::filesystem::rename(temporary, target, ec);
+    if (ec) {
+        std::filesystem::remove(temporary, ec);
+        throw std::runtime_error("Unable to move autotune results into place: " + path);
+    }
+}
+
+std::string GpuKernelAutotuner::deviceKey() {
+    std::string key = glString(GL_VENDOR) + '|' + glString(GL_RENDERER) + '|' + glString(GL_VERSION);
+    // Keys share a line with tab-separated fields.
+    for (char& c : key) {
+        if (c == '\t' || c == '\n' || c == '\r') {
+            c = ' ';
+        }
+    }
+    return key;
+}
+
+// Full solver steps, so a layout's cost in the strain, self-collision and normal passes counts too.
+double GpuKernelAutotuner::timeSteps(GpuPhysicsSolver& solver) {
+    for (int i = 0; i < kWarmupSteps; ++i) {
+        solver.step(kStepDt);
+    }
+    glFinish();
+
+    unsigned int query = 0;
+    glGenQueries(1, &query);
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    for (int i = 0; i < kTimedSteps; ++i) {
+        solver.step(kStepDt);
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    GLuint64 elapsedNs = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsedNs);
+    glDeleteQueries(1, &query);
+    return static_cast<double>(elapsedNs) * 1e-6 / static_cast<double>(kTimedSteps);
+}
+
+std::string GpuKernelAutotuner::entryKey(std::size_t rows, std::size_t cols) {
+    return std::to_string(rows) + "x" + std::to_string(cols) + "|" + deviceKey();
+}
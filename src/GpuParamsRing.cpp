@@ -0,0 +1,107 @@
+#include "GpuParamsRing.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <GL/glew.h>
+
+GpuParamsRing::GpuParamsRing(std::size_t recordsPerFrame, std::size_t frames)
+    : m_recordsPerFrame(recordsPerFrame),
+      m_stride(0),
+      m_buffer(0),
+      m_mapped(nullptr),
+      m_fences(frames, nullptr),
+      m_frame(0) {
+    if (recordsPerFrame == 0 || frames == 0) {
+        throw std::runtime_error("GpuParamsRing requires at least one record and one frame");
+    }
+
+    int alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    const std::size_t align = static_cast<std::size_t>(std::max(alignment, 1));
+    m_stride = (sizeof(GpuSimParams) + align - 1) / align * align;
+
+    const GLsizeiptr ringBytes = static_cast<GLsizeiptr>(m_stride * recordsPerFrame * frames);
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_UNIFORM_BUFFER, ringBytes, nullptr, flags);
+        m_mapped = static_cast<unsigned char*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, ringBytes, flags));
+    }
+    if (m_mapped == nullptr) {
+        glBufferData(GL_UNIFORM_BUFFER, ringBytes, nullptr, GL_DYNAMIC_DRAW);
+        m_staging.assign(m_stride * recordsPerFrame, 0);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+GpuParamsRing::~GpuParamsRing() {
+    for (void* fence : m_fences) {
+        if (fence != nullptr) {
+            glDeleteSync(static_cast<GLsync>(fence));
+        }
+    }
+    if (m_buffer != 0) {
+        if (m_mapped != nullptr) {
+            glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &m_buffer);
+    }
+}
+
+void GpuParamsRing::beginFrame() {
+    // The GPU may still be reading this slot from m_fences.size() frames ago.
+    void*& slotFence = m_fences[m_frame % m_fences.size()];
+    if (slotFence != nullptr) {
+        const GLsync fence = static_cast<GLsync>(slotFence);
+        GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        while (status == GL_TIMEOUT_EXPIRED) {
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        }
+        glDeleteSync(fence);
+        slotFence = nullptr;
+    }
+}
+
+void GpuParamsRing::write(std::size_t record, const GpuSimParams& params) {
+    if (record >= m_recordsPerFrame) {
+        throw std::runtime_error("GpuParamsRing record out of range");
+    }
+    unsigned char* dst = m_mapped != nullptr ? m_mapped + frameBase() : m_staging.data();
+    std::memcpy(dst + record * m_stride, &params, sizeof(params));
+}
+
+void GpuParamsRing::upload(std::size_t records) {
+    if (m_mapped != nullptr || records == 0) {
+        return;
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    glBufferSubData(
+        GL_UNIFORM_BUFFER,
+        static_cast<GLintptr>(frameBase()),
+        static_cast<GLsizeiptr>(std::min(records, m_recordsPerFrame) * m_stride),
+        m_staging.data());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void GpuParamsRing::bind(unsigned int binding, std::size_t record) const {
+    glBindBufferRange(
+        GL_UNIFORM_BUFFER,
+        binding,
+        m_buffer,
+        static_cast<GLintptr>(frameBase() + record * m_stride),
+        static_cast<GLsizeiptr>(sizeof(GpuSimParams)));
+}
+
+void GpuParamsRing::endFrame() {
+    m_fences[m_frame % m_fences.size()] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    ++m_frame;
+}
+
+std::size_t GpuParamsRing::frameBase() const {
+    return (m_frame % m_fences.size()) * m_recordsPerFrame * m_stride;
+}
@@ -2,21 +2,118 @@
 
 #include <algorithm>
 #include <cmath>
-#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
 #include <sstream>
 #include <stdexcept>
 
 #include <GL/glew.h>
 
+#include "Geometry.h"
+#include "GpuParamsRing.h"
+#include "GpuSimParams.h"
+#include "ProgramCache.h"
+#include "SpatialHash.h"
+
 namespace {
 constexpr float kBaseGravity = 9.81f;
+constexpr float kSelfCollisionThicknessScale = 0.75f;
+constexpr unsigned int kSelfCollisionGroupSize = 256;
+constexpr float kColliderThicknessScale = 0.4f;
+constexpr float kColliderFriction = 0.3f;
+constexpr int kMaxSubsteps = 16;
+constexpr unsigned int kMaxGroupInvocations = 1024;
+constexpr unsigned int kNormalsGroupSize = 128;
+constexpr unsigned int kStrainGroupSize = 128;
+constexpr int kDefaultStrainIterations = 4;
+constexpr int kMaxStrainIterations = 16;
+constexpr std::size_t kReadbackLatency = 3;
+constexpr unsigned int kPickGroupSize = 256;
+// GL guarantees 65535 workgroups per dispatch dimension; the pick passes put one ray per workgroup row.
+constexpr std::size_t kMaxPickRaysPerDispatch = 65535;
+// Must match CLOTH_TILE / CLOTH_TILE_SUBSTEPS in cloth_step_tiled.comp.
+constexpr unsigned int kTileSize = 32;
+constexpr int kTileSubsteps = 2;
+constexpr unsigned int kTileInterior = kTileSize - 4 * kTileSubsteps;
+// Must match CG_GROUP_SIZE and the CgParticle / HealthBuffer layout in cloth_cg.comp and cloth_common.glsl.
+constexpr unsigned int kCgGroupSize = 128;
+constexpr std::size_t kCgParticleBytes = 9 * sizeof(glm::vec4);
+constexpr float kCgMaxSubstep = 1.0f / 60.0f;
+constexpr int kDefaultCgIterations = 16;
+constexpr int kMaxCgIterations = 64;
+
+// Binding points shared by every solver program. GpuClothBatch reuses them, so they are re-established
+// at the start of every step and pick. Only 8 storage bindings are guaranteed: 0-4 are fixed, 5-7 carry the
+// step kernels' health / collider / SDF blocks and are rebound by each auxiliary pass for its own buffers.
+constexpr unsigned int kSimParamsBinding = 0;
+constexpr unsigned int kPosBinding = 0;  // posBuf[2] occupies 0 and 1
+constexpr unsigned int kVelBinding = 2;  // velBuf[2] occupies 2 and 3
+constexpr unsigned int kFixedBinding = 4;
+constexpr unsigned int kHealthBinding = 5;  // also carries the CG state, see cloth_cg.comp
+constexpr unsigned int kColliderBinding = 6;
+constexpr unsigned int kSdfBinding = 7;
+constexpr unsigned int kCollisionScratchBinding = 5;
+constexpr unsigned int kHashBinding = 6;
+constexpr unsigned int kNormalBinding = 5;
+constexpr unsigned int kBoundsBinding = 6;
+constexpr unsigned int kPickBinding = 5;
+constexpr unsigned int kPickRayBinding = 6;
+constexpr int kRequiredStorageBindings = 8;
+// Most storage blocks any solver program declares; the CG kernel reaches it by keeping its state in HealthBuffer.
+constexpr int kRequiredComputeStorageBlocks = 8;
+// HealthBuffer: the non-finite flag padded to 16 bytes, then cgScalars and the per-workgroup partial sums.
+constexpr std::size_t kCgScalarsOffset = 16;
+constexpr std::size_t kCgPartialsOffset = kCgScalarsOffset + sizeof(glm::vec4);
+
+enum PickPass {
+    kPickReduce = 0,
+    kPickTie = 1,
+    kPickResolve = 2,
+};
+
+// PickSlot and PickRay in cloth_pick.comp.
+struct GpuPickSlot {
+    std::uint32_t key[2];
+    int index;
+    float t;
+    float distance;
+    std::uint32_t padding;
+};
+
+struct GpuPickRay {
+    glm::vec4 origin;
+    glm::vec4 direction;
+};
+
+enum CgPass {
+    kCgSetup = 0,
+    kCgInitScalars = 1,
+    kCgMultiply = 2,
+    kCgAlpha = 3,
+    kCgUpdate = 4,
+    kCgBeta = 5,
+    kCgIntegrate = 6,
+};
+
+enum SelfCollisionPass {
+    kPassClear = 0,
+    kPassCount = 1,
+    kPassScan = 2,
+    kPassScatter = 3,
+    kPassResolve = 4,
+};
 
-bool isFiniteVec3(const glm::vec3& v) {
-    return std::isfinite(v.x) && std::isfinite(v.y) && std::isfinite(v.z);
+// Inverse of orderedBits in cloth_normals.comp, which reduces the cloth bounds with atomicMax.
+float fromOrderedBits(std::uint32_t u) {
+    const std::uint32_t bits = (u & 0x80000000u) != 0u ? (u & 0x7fffffffu) : ~u;
+    float value = 0.0f;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
 }
 }  // namespace
 
-GpuPhysicsSolver::GpuPhysicsSolver(std::size_t rows, std::size_t cols, float spacing)
+GpuPhysicsSolver::GpuPhysicsSolver(std::size_t rows, std::size_t cols, float spacing, GpuParticleLayout layout)
     : m_rows(rows),
       m_cols(cols),
       m_spacing(spacing),
@@ -29,35 +126,176 @@ GpuPhysicsSolver::GpuPhysicsSolver(std::size_t rows, std::size_t cols, float spa
       m_groundY(-1.2f),
       m_gravity(0.0f, -kBaseGravity, 0.0f),
       m_wind(0.0f),
+      m_selfCollision(false),
+      m_selfCollisionThickness(spacing * kSelfCollisionThicknessScale),
+      m_colliderThickness(spacing * kColliderThicknessScale),
+      m_colliderFriction(kColliderFriction),
+      m_colliderCount(0),
+      m_stepKernel(GpuStepKernel::PerSubstep),
+      m_layout(layout),
+      m_strainIterations(kDefaultStrainIterations),
+      m_cgIterations(kDefaultCgIterations),
+      m_positionsStale(false),
+      m_boundsMin(0.0f),
+      m_boundsMax(0.0f),
+      m_boundsStale(false),
+      m_lastStepDt(0.0f),
       m_draggedIndex(-1),
       m_dragRayT(0.0f),
       m_dragTarget(0.0f),
-      m_computeProgram(0),
+      m_selfCollisionProgram(0),
+      m_strainProgram(0),
+      m_normalsProgram(0),
+      m_pickProgram(0),
       m_posSsboA(0),
       m_posSsboB(0),
       m_velSsboA(0),
       m_velSsboB(0),
       m_fixedSsbo(0),
-      m_pingPongFlip(false) {
+      m_healthSsbo(0),
+      m_normalSsbo(0),
+      m_boundsSsbo(0),
+      m_pickSsbo(0),
+      m_pickRaySsbo(0),
+      m_colliderSsbo(0),
+      m_sdfSsbo(0),
+      m_collisionScratchSsbo(0),
+      m_hashSsbo(0),
+      m_hashTableSize(SpatialHash::tableSizeFor(rows * cols)),
+      m_selfCollisionPassLocation(-1),
+      m_strainSourceLocation(-1),
+      m_pickInt64(false),
+      m_pickPassLocation(-1),
+      m_pickPosIndexLocation(-1),
+      m_pickRayCountLocation(-1),
+      m_pickRayBaseLocation(-1),
+      m_pickMaxDistanceLocation(-1),
+      m_pingPongFlip(false),
+      m_positionSerial(0),
+      m_healthSerial(0),
+      m_boundsSerial(0) {
     if (rows < 2 || cols < 2) {
         throw std::runtime_error("GpuPhysicsSolver requires rows and cols >= 2");
     }
 
-    const std::string source = loadTextFile("shaders/cloth_step.comp");
-    m_computeProgram = compileComputeProgram(source);
+    std::ostringstream spacingLiteral;
+    spacingLiteral << std::setprecision(9) << std::showpoint << spacing;
+    m_kernelDefines = {
+        "CLOTH_ROWS " + std::to_string(rows),
+        "CLOTH_COLS " + std::to_string(cols),
+        "CLOTH_SPACING " + spacingLiteral.str(),
+    };
+    if (layout == GpuParticleLayout::Packed) {
+        m_kernelDefines.push_back("CLOTH_PACKED_STATE 1");
+    } else if (layout == GpuParticleLayout::PackedHalfVelocity) {
+        m_kernelDefines.push_back("CLOTH_HALF_VELOCITY 1");
+    }
+
+    int storageBindings = 0;
+    glGetIntegerv(GL_MAX_SHADER_STORAGE_BUFFER_BINDINGS, &storageBindings);
+    if (storageBindings < kRequiredStorageBindings) {
+        throw std::runtime_error(
+            "GpuPhysicsSolver needs at least " + std::to_string(kRequiredStorageBindings) +
+            " shader storage buffer bindings");
+    }
+    int computeStorageBlocks = 0;
+    glGetIntegerv(GL_MAX_COMPUTE_SHADER_STORAGE_BLOCKS, &computeStorageBlocks);
+    if (computeStorageBlocks < kRequiredComputeStorageBlocks) {
+        throw std::runtime_error(
+            "GpuPhysicsSolver needs at least " + std::to_string(kRequiredComputeStorageBlocks) +
+            " shader storage blocks per compute shader");
+    }
+
+    // Build every default step variant now so a compile failure surfaces here rather than mid-simulation.
+    const GpuStepKernel defaultKernels[] = {
+        GpuStepKernel::Tiled,
+        GpuStepKernel::ConjugateGradient,
+        GpuStepKernel::PerSubstep,
+    };
+    for (const GpuStepKernel kernel : defaultKernels) {
+        m_stepKernel = kernel;
+        stepProgram();
+    }
+    m_selfCollisionProgram = compileSolverProgram("shaders/cloth_self_collision.comp", {});
+    m_selfCollisionPassLocation = glGetUniformLocation(m_selfCollisionProgram, "uPass");
+    m_strainProgram = compileSolverProgram("shaders/cloth_strain.comp", {});
+    m_strainSourceLocation = glGetUniformLocation(m_strainProgram, "uSource");
+    glUseProgram(m_strainProgram);
+    glUniform1f(glGetUniformLocation(m_strainProgram, "uMaxStretchRatio"), m_maxStretchRatio);
+    glUseProgram(0);
+    m_normalsProgram = compileSolverProgram("shaders/cloth_normals.comp", {});
+
+    // One 64-bit atomicMin settles (distance, index) per workgroup; without it the pick takes a second pass.
+    m_pickInt64 = GLEW_ARB_gpu_shader_int64 && GLEW_NV_shader_atomic_int64;
+    std::vector<std::string> pickDefines;
+    if (m_pickInt64) {
+        pickDefines.push_back("CLOTH_PICK_INT64 1");
+    }
+    m_pickProgram = compileSolverProgram("shaders/cloth_pick.comp", pickDefines);
+    m_pickPassLocation = glGetUniformLocation(m_pickProgram, "uPass");
+    m_pickPosIndexLocation = glGetUniformLocation(m_pickProgram, "uPosIndex");
+    m_pickRayCountLocation = glGetUniformLocation(m_pickProgram, "uRayCount");
+    m_pickRayBaseLocation = glGetUniformLocation(m_pickProgram, "uRayBase");
+    m_pickMaxDistanceLocation = glGetUniformLocation(m_pickProgram, "uMaxDistance");
+    glUseProgram(m_pickProgram);
+    glUniform1i(glGetUniformLocation(m_pickProgram, "uParticleCount"), static_cast<int>(rows * cols));
+    glUseProgram(0);
 
     glGenBuffers(1, &m_posSsboA);
     glGenBuffers(1, &m_posSsboB);
     glGenBuffers(1, &m_velSsboA);
     glGenBuffers(1, &m_velSsboB);
     glGenBuffers(1, &m_fixedSsbo);
+    glGenBuffers(1, &m_healthSsbo);
+    glGenBuffers(1, &m_normalSsbo);
+    glGenBuffers(1, &m_boundsSsbo);
+    glGenBuffers(1, &m_pickSsbo);
+    glGenBuffers(1, &m_pickRaySsbo);
+    glGenBuffers(1, &m_colliderSsbo);
+    glGenBuffers(1, &m_sdfSsbo);
+    glGenBuffers(1, &m_collisionScratchSsbo);
+    glGenBuffers(1, &m_hashSsbo);
 
     initializeGrid();
     pinConstraints();
     uploadInitialStateToGpu();
+    setColliders(nullptr);
+    m_paramsRing = std::make_unique<GpuParamsRing>(kMaxSubsteps, kParamsFrames);
+
+    m_positionReadback = std::make_unique<AsyncReadback>(m_positionsCpu.size() * positionStride(), kReadbackLatency);
+    m_healthReadback = std::make_unique<AsyncReadback>(sizeof(unsigned int), kReadbackLatency);
+    m_boundsReadback = std::make_unique<AsyncReadback>(6 * sizeof(std::uint32_t), kReadbackLatency);
+    resetBounds();
 }
 
 GpuPhysicsSolver::~GpuPhysicsSolver() {
+    const unsigned int hashBuffers[] = {m_collisionScratchSsbo, m_hashSsbo};
+    for (const unsigned int buffer : hashBuffers) {
+        if (buffer != 0) {
+            glDeleteBuffers(1, &buffer);
+        }
+    }
+    const unsigned int colliderBuffers[] = {m_colliderSsbo, m_sdfSsbo};
+    for (const unsigned int buffer : colliderBuffers) {
+        if (buffer != 0) {
+            glDeleteBuffers(1, &buffer);
+        }
+    }
+    if (m_pickSsbo != 0) {
+        glDeleteBuffers(1, &m_pickSsbo);
+    }
+    if (m_pickRaySsbo != 0) {
+        glDeleteBuffers(1, &m_pickRaySsbo);
+    }
+    if (m_normalSsbo != 0) {
+        glDeleteBuffers(1, &m_normalSsbo);
+    }
+    if (m_boundsSsbo != 0) {
+        glDeleteBuffers(1, &m_boundsSsbo);
+    }
+    if (m_healthSsbo != 0) {
+        glDeleteBuffers(1, &m_healthSsbo);
+    }
     if (m_fixedSsbo != 0) {
         glDeleteBuffers(1, &m_fixedSsbo);
     }
@@ -73,8 +311,20 @@ GpuPhysicsSolver::~GpuPhysicsSolver() {
     if (m_posSsboA != 0) {
         glDeleteBuffers(1, &m_posSsboA);
     }
-    if (m_computeProgram != 0) {
-        glDeleteProgram(m_computeProgram);
+    if (m_pickProgram != 0) {
+        glDeleteProgram(m_pickProgram);
+    }
+    if (m_normalsProgram != 0) {
+        glDeleteProgram(m_normalsProgram);
+    }
+    if (m_strainProgram != 0) {
+        glDeleteProgram(m_strainProgram);
+    }
+    if (m_selfCollisionProgram != 0) {
+        glDeleteProgram(m_selfCollisionProgram);
+    }
+    for (const auto& entry : m_stepPrograms) {
+        glDeleteProgram(entry.second.program);
     }
 }
 
@@ -83,59 +333,81 @@ void GpuPhysicsSolver::step(float dt) {
         return;
     }
 
+    const bool conjugateGradient = m_stepKernel == GpuStepKernel::ConjugateGradient;
     const float clampedDt = std::min(dt, 1.0f / 30.0f);
-    const float maxSubstep = 1.0f / 240.0f;
-    const int substeps = std::max(1, static_cast<int>(std::ceil(clampedDt / maxSubstep)));
+    m_lastStepDt = clampedDt;
+    const float maxSubstep = conjugateGradient ? kCgMaxSubstep : 1.0f / 240.0f;
+    // Capped at the ring's per-frame record count; only reachable through float rounding at the dt clamp.
+    const int substeps = std::clamp(static_cast<int>(std::ceil(clampedDt / maxSubstep)), 1, kMaxSubsteps);
     const float h = clampedDt / static_cast<float>(substeps);
 
-    for (int i = 0; i < substeps; ++i) {
-        const unsigned int posIn = m_pingPongFlip ? m_posSsboB : m_posSsboA;
-        const unsigned int velIn = m_pingPongFlip ? m_velSsboB : m_velSsboA;
-        const unsigned int posOut = m_pingPongFlip ? m_posSsboA : m_posSsboB;
-        const unsigned int velOut = m_pingPongFlip ? m_velSsboA : m_velSsboB;
-
-        glUseProgram(m_computeProgram);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, posIn);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, velIn);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, posOut);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, velOut);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_fixedSsbo);
-
-        glUniform1i(glGetUniformLocation(m_computeProgram, "uRows"), static_cast<int>(m_rows));
-        glUniform1i(glGetUniformLocation(m_computeProgram, "uCols"), static_cast<int>(m_cols));
-        glUniform1i(glGetUniformLocation(m_computeProgram, "uNumParticles"), static_cast<int>(m_rows * m_cols));
-        glUniform1f(glGetUniformLocation(m_computeProgram, "uDt"), h);
-        glUniform1f(glGetUniformLocation(m_computeProgram, "uSpacing"), m_spacing);
-        glUniform1f(glGetUniformLocation(m_computeProgram, "uMass"), m_mass);
-        glUniform1f(glGetUniformLocation(m_computeProgram, "uStiffness"), m_stiffness);
-        glUniform1f(glGetUniformLocation(m_computeProgram, "uDamping"), m_damping);
-        glUniform1f(glGetUniformLocation(m_computeProgram, "uSpringDamping"), m_springDamping);
-        glUniform1f(glGetUniformLocation(m_computeProgram, "uMaxSpeed"), m_maxSpeed);
-        glUniform1f(glGetUniformLocation(m_computeProgram, "uGroundY"), m_groundY);
-        glUniform3f(glGetUniformLocation(m_computeProgram, "uGravity"), m_gravity.x, m_gravity.y, m_gravity.z);
-        glUniform3f(glGetUniformLocation(m_computeProgram, "uWind"), m_wind.x, m_wind.y, m_wind.z);
-        glUniform1i(glGetUniformLocation(m_computeProgram, "uDraggedIndex"), m_draggedIndex);
-        glUniform3f(
-            glGetUniformLocation(m_computeProgram, "uDragTarget"),
-            m_dragTarget.x,
-            m_dragTarget.y,
-            m_dragTarget.z);
-
-        const unsigned int numParticles = static_cast<unsigned int>(m_rows * m_cols);
-        const unsigned int groups = (numParticles + 127u) / 128u;
-        glDispatchCompute(groups, 1, 1);
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    // Only the flag; the CG state behind it is rebuilt by every setup pass.
+    const unsigned int zero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_healthSsbo);
+    glClearBufferSubData(
+        GL_SHADER_STORAGE_BUFFER,
+        GL_R32UI,
+        0,
+        sizeof(unsigned int),
+        GL_RED_INTEGER,
+        GL_UNSIGNED_INT,
+        &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
-        m_pingPongFlip = !m_pingPongFlip;
+    // The tiled kernel covers kTileSubsteps substeps per dispatch, so self-collision also runs once per dispatch.
+    const bool tiled = m_stepKernel == GpuStepKernel::Tiled;
+    const int substepsPerDispatch = tiled ? kTileSubsteps : 1;
+    const int dispatches = (substeps + substepsPerDispatch - 1) / substepsPerDispatch;
+    writeDispatchParams(h, substeps, substepsPerDispatch);
+    bindStaticBuffers();
+
+    const StepProgram& program = stepProgram();
+    const unsigned int numParticles = static_cast<unsigned int>(m_rows * m_cols);
+    const unsigned int rowsU = static_cast<unsigned int>(m_rows);
+    const unsigned int colsU = static_cast<unsigned int>(m_cols);
+    const unsigned int groupX = m_stepOptions.groupSizeX;
+    const unsigned int groupY = m_stepOptions.groupSizeY;
+    unsigned int groupsX = (numParticles + groupX - 1) / groupX;
+    unsigned int groupsY = 1;
+    if (tiled) {
+        groupsX = (colsU + kTileInterior - 1) / kTileInterior;
+        groupsY = (rowsU + kTileInterior - 1) / kTileInterior;
+    } else if (groupY > 1) {
+        groupsX = (colsU + groupX - 1) / groupX;
+        groupsY = (rowsU + groupY - 1) / groupY;
     }
+    for (int i = 0; i < dispatches; ++i) {
+        m_paramsRing->bind(kSimParamsBinding, static_cast<std::size_t>(i));
+        bindStepBuffers();
+
+        if (conjugateGradient) {
+            solveConjugateGradient(program);
+        } else {
+            glUseProgram(program.program);
+            glDispatchCompute(groupsX, groupsY, 1);
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        }
 
-    readBackPositions();
-    for (const glm::vec3& p : m_positionsCpu) {
-        if (!isFiniteVec3(p)) {
-            reset();
-            return;
+        m_pingPongFlip = !m_pingPongFlip;
+
+        satisfyStrainConstraints(positionBuffer());
+        if (m_selfCollision) {
+            resolveSelfCollisions(positionBuffer());
         }
     }
+
+    computeNormals();
+    m_healthReadback->enqueue(m_healthSsbo);
+    m_boundsReadback->enqueue(m_boundsSsbo);
+
+    m_paramsRing->endFrame();
+    m_positionsStale = true;
+    m_boundsStale = true;
+
+    // A non-finite state is only noticed once its health snapshot lands, a few frames after the fact.
+    if (collectReadbacks()) {
+        reset();
+    }
 }
 
 void GpuPhysicsSolver::reset() {
@@ -147,16 +419,79 @@ void GpuPhysicsSolver::reset() {
     m_dragRayT = 0.0f;
     m_dragTarget = glm::vec3(0.0f);
     m_pingPongFlip = false;
+    m_positionsStale = false;
 
     initializeGrid();
     pinConstraints();
     uploadInitialStateToGpu();
+
+    // Copies still in flight describe the pre-reset cloth.
+    m_positionReadback->discard();
+    m_healthReadback->discard();
+    m_boundsReadback->discard();
+    m_positionSerial = m_positionReadback->snapshotSerial();
+    m_healthSerial = m_healthReadback->snapshotSerial();
+    resetBounds();
 }
 
 const std::vector<glm::vec3>& GpuPhysicsSolver::getPositions() const {
     return m_positionsCpu;
 }
 
+void GpuPhysicsSolver::requestPositions() {
+    m_positionReadback->enqueue(positionBuffer());
+}
+
+void GpuPhysicsSolver::syncPositions() {
+    if (m_positionsStale) {
+        m_positionReadback->readNow(positionBuffer());
+        applyPositionSnapshot();
+        m_positionsStale = false;
+    }
+}
+
+void GpuPhysicsSolver::getBounds(glm::vec3& boundsMin, glm::vec3& boundsMax) const {
+    boundsMin = m_boundsMin;
+    boundsMax = m_boundsMax;
+    if (m_boundsStale) {
+        const glm::vec3 slack(m_maxSpeed * m_lastStepDt * static_cast<float>(kReadbackLatency + 1));
+        boundsMin -= slack;
+        boundsMax += slack;
+    }
+    if (m_draggedIndex >= 0) {
+        boundsMin = glm::min(boundsMin, m_dragTarget);
+        boundsMax = glm::max(boundsMax, m_dragTarget);
+    }
+}
+
+unsigned int GpuPhysicsSolver::positionBuffer() const {
+    return m_pingPongFlip ? m_posSsboB : m_posSsboA;
+}
+
+unsigned int GpuPhysicsSolver::normalBuffer() const {
+    return m_normalSsbo;
+}
+
+GpuParticleLayout GpuPhysicsSolver::particleLayout() const {
+    return m_layout;
+}
+
+std::size_t GpuPhysicsSolver::positionStride() const {
+    return m_layout == GpuParticleLayout::Vec4 ? sizeof(glm::vec4) : sizeof(glm::vec3);
+}
+
+std::size_t GpuPhysicsSolver::velocityStride() const {
+    switch (m_layout) {
+    case GpuParticleLayout::Packed:
+        return sizeof(glm::vec3);
+    case GpuParticleLayout::PackedHalfVelocity:
+        return 2 * sizeof(std::uint32_t);
+    case GpuParticleLayout::Vec4:
+        break;
+    }
+    return sizeof(glm::vec4);
+}
+
 float GpuPhysicsSolver::getStiffness() const {
     return m_stiffness;
 }
@@ -191,42 +526,113 @@ void GpuPhysicsSolver::setWindStrength(float windStrength) {
     m_wind = glm::vec3(clamped, 0.0f, 0.0f);
 }
 
-bool GpuPhysicsSolver::beginDrag(const glm::vec3& rayOrigin, const glm::vec3& rayDir, float maxDistance) {
-    if (glm::length(rayDir) <= 1e-6f) {
-        return false;
+void GpuPhysicsSolver::setSelfCollisionEnabled(bool enabled) {
+    m_selfCollision = enabled;
+}
+
+bool GpuPhysicsSolver::isSelfCollisionEnabled() const {
+    return m_selfCollision;
+}
+
+void GpuPhysicsSolver::setColliders(std::shared_ptr<const ColliderSet> colliders) {
+    // Triangle meshes have no GPU narrowphase; bake them into an SDF collider to get them on this path.
+    GpuColliderData data;
+    if (colliders) {
+        data = colliders->gpuData();
+    }
+    const int previousCount = m_colliderCount;
+    m_colliderCount = static_cast<int>(data.records.size());
+    try {
+        stepProgram();
+    } catch (...) {
+        m_colliderCount = previousCount;
+        throw;
+    }
+    if (data.records.empty()) {
+        data.records.push_back(GpuColliderRecord{});
+    }
+    if (data.sdfData.empty()) {
+        data.sdfData.push_back(0u);
     }
 
-    int bestIndex = -1;
-    float bestDist = maxDistance;
-    float bestT = 0.0f;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_colliderSsbo);
+    glBufferData(
+        GL_SHADER_STORAGE_BUFFER,
+        static_cast<GLsizeiptr>(data.records.size() * sizeof(GpuColliderRecord)),
+        data.records.data(),
+        GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_sdfSsbo);
+    glBufferData(
+        GL_SHADER_STORAGE_BUFFER,
+        static_cast<GLsizeiptr>(data.sdfData.size() * sizeof(std::uint32_t)),
+        data.sdfData.data(),
+        GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
 
-    for (std::size_t i = 0; i < m_positionsCpu.size(); ++i) {
-        if (m_fixedFlags[i] != 0) {
-            continue;
-        }
+void GpuPhysicsSolver::setStepKernel(GpuStepKernel kernel) {
+    const GpuStepKernel previous = m_stepKernel;
+    m_stepKernel = kernel;
+    try {
+        stepProgram();
+    } catch (...) {
+        m_stepKernel = previous;
+        throw;
+    }
+}
 
-        const glm::vec3 toParticle = m_positionsCpu[i] - rayOrigin;
-        const float t = glm::dot(toParticle, rayDir);
-        if (t < 0.0f) {
-            continue;
-        }
+GpuStepKernel GpuPhysicsSolver::stepKernel() const {
+    return m_stepKernel;
+}
 
-        const glm::vec3 closest = rayOrigin + rayDir * t;
-        const float dist = glm::length(m_positionsCpu[i] - closest);
-        if (dist < bestDist) {
-            bestDist = dist;
-            bestIndex = static_cast<int>(i);
-            bestT = t;
-        }
+void GpuPhysicsSolver::setStrainIterations(int iterations) {
+    m_strainIterations = std::clamp(iterations, 0, kMaxStrainIterations);
+}
+
+int GpuPhysicsSolver::strainIterations() const {
+    return m_strainIterations;
+}
+
+void GpuPhysicsSolver::setCgIterations(int iterations) {
+    m_cgIterations = std::clamp(iterations, 1, kMaxCgIterations);
+}
+
+int GpuPhysicsSolver::cgIterations() const {
+    return m_cgIterations;
+}
+
+void GpuPhysicsSolver::setStepKernelOptions(const GpuStepKernelOptions& options) {
+    if (options.groupSizeX == 0 || options.groupSizeY == 0 ||
+        options.groupSizeX * options.groupSizeY > kMaxGroupInvocations) {
+        throw std::runtime_error("GpuStepKernelOptions workgroup must have between 1 and 1024 invocations");
+    }
+    const GpuStepKernelOptions previous = m_stepOptions;
+    m_stepOptions = options;
+    try {
+        stepProgram();
+    } catch (...) {
+        m_stepOptions = previous;
+        throw;
     }
+}
+
+const GpuStepKernelOptions& GpuPhysicsSolver::stepKernelOptions() const {
+    return m_stepOptions;
+}
 
-    if (bestIndex < 0) {
+bool GpuPhysicsSolver::beginDrag(const glm::vec3& rayOrigin, const glm::vec3& rayDir, float maxDistance) {
+    if (glm::length(rayDir) <= 1e-6f) {
         return false;
     }
 
-    m_draggedIndex = bestIndex;
-    m_dragRayT = bestT;
-    m_dragTarget = rayOrigin + rayDir * bestT;
+    const ParticlePickHit hit = pickOnGpu({ParticleRay{rayOrigin, rayDir}}, maxDistance).front();
+    if (hit.index < 0) {
+        return false;
+    }
+
+    m_draggedIndex = hit.index;
+    m_dragRayT = hit.t;
+    m_dragTarget = rayOrigin + rayDir * hit.t;
     return true;
 }
 
@@ -252,6 +658,13 @@ bool GpuPhysicsSolver::isDragging() const {
     return m_draggedIndex >= 0;
 }
 
+std::vector<ParticlePickHit> GpuPhysicsSolver::pickParticles(const std::vector<ParticleRay>& rays, float maxDistance) const {
+    if (rays.empty()) {
+        return {};
+    }
+    return pickOnGpu(rays, maxDistance);
+}
+
 std::size_t GpuPhysicsSolver::index(std::size_t row, std::size_t col) const {
     return row * m_cols + col;
 }
@@ -278,39 +691,26 @@ void GpuPhysicsSolver::pinConstraints() {
 }
 
 void GpuPhysicsSolver::uploadInitialStateToGpu() {
-    std::vector<glm::vec4> pos4(m_positionsCpu.size(), glm::vec4(0.0f));
-    std::vector<glm::vec4> vel4(m_positionsCpu.size(), glm::vec4(0.0f));
+    // Positions are written as the first three floats of every stride; velocities start at rest, which is
+    // all-zero bytes in every layout.
+    const std::size_t posStride = positionStride();
+    std::vector<unsigned char> posBytes(m_positionsCpu.size() * posStride, 0);
     for (std::size_t i = 0; i < m_positionsCpu.size(); ++i) {
-        pos4[i] = glm::vec4(m_positionsCpu[i], 0.0f);
+        std::memcpy(posBytes.data() + i * posStride, &m_positionsCpu[i], sizeof(glm::vec3));
     }
+    const std::vector<unsigned char> velBytes(m_positionsCpu.size() * velocityStride(), 0);
 
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_posSsboA);
-    glBufferData(
-        GL_SHADER_STORAGE_BUFFER,
-        static_cast<GLsizeiptr>(pos4.size() * sizeof(glm::vec4)),
-        pos4.data(),
-        GL_DYNAMIC_DRAW);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(posBytes.size()), posBytes.data(), GL_DYNAMIC_DRAW);
 
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_posSsboB);
-    glBufferData(
-        GL_SHADER_STORAGE_BUFFER,
-        static_cast<GLsizeiptr>(pos4.size() * sizeof(glm::vec4)),
-        pos4.data(),
-        GL_DYNAMIC_DRAW);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(posBytes.size()), posBytes.data(), GL_DYNAMIC_DRAW);
 
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_velSsboA);
-    glBufferData(
-        GL_SHADER_STORAGE_BUFFER,
-        static_cast<GLsizeiptr>(vel4.size() * sizeof(glm::vec4)),
-        vel4.data(),
-        GL_DYNAMIC_DRAW);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(velBytes.size()), velBytes.data(), GL_DYNAMIC_DRAW);
 
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_velSsboB);
-    glBufferData(
-        GL_SHADER_STORAGE_BUFFER,
-        static_cast<GLsizeiptr>(vel4.size() * sizeof(glm::vec4)),
-        vel4.data(),
-        GL_DYNAMIC_DRAW);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(velBytes.size()), velBytes.data(), GL_DYNAMIC_DRAW);
 
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_fixedSsbo);
     glBufferData(
@@ -319,68 +719,367 @@ void GpuPhysicsSolver::uploadInitialStateToGpu() {
         m_fixedFlags.data(),
         GL_STATIC_DRAW);
 
+    const GLsizeiptr particleBytes = static_cast<GLsizeiptr>(posBytes.size());
+    const GLsizeiptr particleIndexBytes = static_cast<GLsizeiptr>(m_positionsCpu.size() * sizeof(unsigned int));
+    // HashBuffer: bucketCount[T], bucketStart[T + 1], particleBucket[N], sortedParticles[N].
+    const GLsizeiptr hashBytes =
+        static_cast<GLsizeiptr>((2 * m_hashTableSize + 1) * sizeof(unsigned int)) + 2 * particleIndexBytes;
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_collisionScratchSsbo);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, particleBytes, nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_hashSsbo);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, hashBytes, nullptr, GL_DYNAMIC_COPY);
+
+    // A freshly initialized grid is flat in xz, so every normal starts straight up.
+    const std::vector<std::uint32_t> normals(m_positionsCpu.size(), packOctahedralNormal(glm::vec3(0.0f, 1.0f, 0.0f)));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_normalSsbo);
+    glBufferData(
+        GL_SHADER_STORAGE_BUFFER,
+        static_cast<GLsizeiptr>(normals.size() * sizeof(std::uint32_t)),
+        normals.data(),
+        GL_DYNAMIC_COPY);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_boundsSsbo);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, 6 * sizeof(std::uint32_t), nullptr, GL_DYNAMIC_COPY);
+
+    // The CG partial sums are padded to 16 bytes so the CgParticle array starts aligned.
+    const std::size_t cgGroups = (m_positionsCpu.size() + kCgGroupSize - 1) / kCgGroupSize;
+    const std::size_t healthHeaderBytes = (kCgPartialsOffset + cgGroups * sizeof(float) + 15) / 16 * 16;
+    const unsigned int healthInit = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_healthSsbo);
+    glBufferData(
+        GL_SHADER_STORAGE_BUFFER,
+        static_cast<GLsizeiptr>(healthHeaderBytes + m_positionsCpu.size() * kCgParticleBytes),
+        nullptr,
+        GL_DYNAMIC_COPY);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(unsigned int), &healthInit);
+
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 }
 
-void GpuPhysicsSolver::readBackPositions() {
-    const unsigned int currentPos = m_pingPongFlip ? m_posSsboB : m_posSsboA;
+void GpuPhysicsSolver::satisfyStrainConstraints(unsigned int positionBuffer) {
+    if (m_strainIterations <= 0) {
+        return;
+    }
+
+    const unsigned int numParticles = static_cast<unsigned int>(m_rows * m_cols);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kCollisionScratchBinding, m_collisionScratchSsbo);
+    glUseProgram(m_strainProgram);
+    for (int i = 0; i < m_strainIterations; ++i) {
+        // Even iterations read positionBuffer and write scratch; odd ones go the other way.
+        glUniform1i(m_strainSourceLocation, i % 2);
+        glDispatchCompute((numParticles + kStrainGroupSize - 1) / kStrainGroupSize, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+    if (m_strainIterations % 2 == 0) {
+        return;
+    }
+
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_COPY_READ_BUFFER, m_collisionScratchSsbo);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, positionBuffer);
+    glCopyBufferSubData(
+        GL_COPY_READ_BUFFER,
+        GL_COPY_WRITE_BUFFER,
+        0,
+        0,
+        static_cast<GLsizeiptr>(numParticles * positionStride()));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void GpuPhysicsSolver::resolveSelfCollisions(unsigned int positionBuffer) {
+    const unsigned int numParticles = static_cast<unsigned int>(m_rows * m_cols);
+    const unsigned int particleGroups = (numParticles + kSelfCollisionGroupSize - 1) / kSelfCollisionGroupSize;
+    const unsigned int bucketGroups = (m_hashTableSize + kSelfCollisionGroupSize - 1) / kSelfCollisionGroupSize;
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kCollisionScratchBinding, m_collisionScratchSsbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kHashBinding, m_hashSsbo);
+    glUseProgram(m_selfCollisionProgram);
+
+    const struct {
+        int pass;
+        unsigned int groups;
+    } passes[] = {
+        {kPassClear, bucketGroups},
+        {kPassCount, particleGroups},
+        {kPassScan, 1},
+        {kPassScatter, particleGroups},
+        {kPassResolve, particleGroups},
+    };
+    for (const auto& pass : passes) {
+        glUniform1i(m_selfCollisionPassLocation, pass.pass);
+        glDispatchCompute(pass.groups, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    // The resolve pass is Jacobi-style (reads positionBuffer, writes scratch), so copy the result back.
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_COPY_READ_BUFFER, m_collisionScratchSsbo);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, positionBuffer);
+    glCopyBufferSubData(
+        GL_COPY_READ_BUFFER,
+        GL_COPY_WRITE_BUFFER,
+        0,
+        0,
+        static_cast<GLsizeiptr>(numParticles * positionStride()));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+// One implicit step: setup, then per iteration a stencil multiply and a vector update, each followed by a
+// single-workgroup pass that finishes its dot product into alpha or beta. Integration writes the ping-pong
+// output like the other step kernels.
+void GpuPhysicsSolver::solveConjugateGradient(const StepProgram& program) {
+    const unsigned int numParticles = static_cast<unsigned int>(m_rows * m_cols);
+    const unsigned int groups = (numParticles + kCgGroupSize - 1) / kCgGroupSize;
+    const int passLocation = program.passLocation;
+    const int slotLocation = program.slotLocation;
+    glUseProgram(program.program);
 
-    std::vector<glm::vec4> pos4(m_positionsCpu.size(), glm::vec4(0.0f));
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, currentPos);
+    const auto dispatchPass = [passLocation](int pass, unsigned int passGroups) {
+        glUniform1i(passLocation, pass);
+        glDispatchCompute(passGroups, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    };
+    dispatchPass(kCgSetup, groups);
+    dispatchPass(kCgInitScalars, 1);
+    for (int i = 0; i < m_cgIterations; ++i) {
+        glUniform1i(slotLocation, i % 2);
+        dispatchPass(kCgMultiply, groups);
+        dispatchPass(kCgAlpha, 1);
+        dispatchPass(kCgUpdate, groups);
+        dispatchPass(kCgBeta, 1);
+    }
+    dispatchPass(kCgIntegrate, groups);
+}
+
+void GpuPhysicsSolver::computeNormals() {
+    const unsigned int numParticles = static_cast<unsigned int>(m_rows * m_cols);
+    const unsigned int empty = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_boundsSsbo);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &empty);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kNormalBinding, m_normalSsbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kBoundsBinding, m_boundsSsbo);
+    glUseProgram(m_normalsProgram);
+    glDispatchCompute((numParticles + kNormalsGroupSize - 1) / kNormalsGroupSize, 1, 1);
+    // Positions and normals are consumed as vertex attributes; positions and bounds are copied out by the readbacks.
+    glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+// Brute-force over every particle for every ray: one distance per invocation, a shared-memory reduction per
+// workgroup and a single global atomic per workgroup into that ray's slot. All rays share one blocking read.
+std::vector<ParticlePickHit> GpuPhysicsSolver::pickOnGpu(
+    const std::vector<ParticleRay>& rays,
+    float maxDistance) const {
+    const unsigned int numParticles = static_cast<unsigned int>(m_rows * m_cols);
+    const unsigned int noHit = 0xffffffffu;
+
+    std::vector<GpuPickRay> rayRecords;
+    rayRecords.reserve(rays.size());
+    for (const ParticleRay& ray : rays) {
+        rayRecords.push_back(GpuPickRay{glm::vec4(ray.origin, 0.0f), glm::vec4(ray.direction, 0.0f)});
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_pickRaySsbo);
+    glBufferData(
+        GL_SHADER_STORAGE_BUFFER,
+        static_cast<GLsizeiptr>(rayRecords.size() * sizeof(GpuPickRay)),
+        rayRecords.data(),
+        GL_STREAM_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_pickSsbo);
+    glBufferData(
+        GL_SHADER_STORAGE_BUFFER,
+        static_cast<GLsizeiptr>(rays.size() * sizeof(GpuPickSlot)),
+        nullptr,
+        GL_STREAM_READ);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &noHit);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    bindStaticBuffers();
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kPickBinding, m_pickSsbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kPickRayBinding, m_pickRaySsbo);
+    glUseProgram(m_pickProgram);
+    glUniform1i(m_pickPosIndexLocation, m_pingPongFlip ? 1 : 0);
+    glUniform1i(m_pickRayCountLocation, static_cast<int>(rays.size()));
+    glUniform1f(m_pickMaxDistanceLocation, maxDistance);
+
+    const unsigned int groups = (numParticles + kPickGroupSize - 1) / kPickGroupSize;
+    const auto dispatchRays = [&](int pass) {
+        glUniform1i(m_pickPassLocation, pass);
+        for (std::size_t base = 0; base < rays.size(); base += kMaxPickRaysPerDispatch) {
+            const std::size_t count = std::min(rays.size() - base, kMaxPickRaysPerDispatch);
+            glUniform1i(m_pickRayBaseLocation, static_cast<int>(base));
+            glDispatchCompute(groups, static_cast<unsigned int>(count), 1);
+        }
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    };
+    dispatchRays(kPickReduce);
+    if (!m_pickInt64) {
+        dispatchRays(kPickTie);
+    }
+    glUniform1i(m_pickPassLocation, kPickResolve);
+    glDispatchCompute(static_cast<unsigned int>((rays.size() + kPickGroupSize - 1) / kPickGroupSize), 1, 1);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    std::vector<GpuPickSlot> slots(rays.size());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_pickSsbo);
     glGetBufferSubData(
         GL_SHADER_STORAGE_BUFFER,
         0,
-        static_cast<GLsizeiptr>(pos4.size() * sizeof(glm::vec4)),
-        pos4.data());
+        static_cast<GLsizeiptr>(slots.size() * sizeof(GpuPickSlot)),
+        slots.data());
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
+    std::vector<ParticlePickHit> hits(slots.size());
+    for (std::size_t i = 0; i < slots.size(); ++i) {
+        hits[i].index = slots[i].index;
+        hits[i].t = slots[i].t;
+        hits[i].distance = slots[i].distance;
+    }
+    return hits;
+}
+
+// Returns the step kernel specialized for the current kernel choice, options and collider presence. The
+// setters that change the key compile it eagerly, so from step() this is only ever a lookup.
+const GpuPhysicsSolver::StepProgram& GpuPhysicsSolver::stepProgram() {
+    std::string path = "shaders/cloth_step.comp";
+    if (m_stepKernel == GpuStepKernel::Tiled) {
+        path = "shaders/cloth_step_tiled.comp";
+    } else if (m_stepKernel == GpuStepKernel::ConjugateGradient) {
+        path = "shaders/cloth_cg.comp";
+    }
+    std::vector<std::string> defines = {
+        "CLOTH_SPRING_COUNT " + std::to_string(m_stepOptions.bendSprings ? 12 : 8),
+        "CLOTH_COLLIDERS " + std::to_string(m_colliderCount > 0 ? 1 : 0),
+    };
+    if (m_stepKernel == GpuStepKernel::PerSubstep) {
+        defines.push_back("CLOTH_GROUP_X " + std::to_string(m_stepOptions.groupSizeX));
+        defines.push_back("CLOTH_GROUP_Y " + std::to_string(m_stepOptions.groupSizeY));
+    }
+
+    std::string key = path;
+    for (const std::string& define : defines) {
+        key += '|' + define;
+    }
+    const auto found = m_stepPrograms.find(key);
+    if (found != m_stepPrograms.end()) {
+        return found->second;
+    }
+
+    StepProgram compiled{};
+    compiled.program = compileSolverProgram(path, defines);
+    compiled.passLocation = glGetUniformLocation(compiled.program, "uPass");
+    compiled.slotLocation = glGetUniformLocation(compiled.program, "uPSlot");
+    return m_stepPrograms.emplace(key, compiled).first->second;
+}
+
+unsigned int GpuPhysicsSolver::compileSolverProgram(
+    const std::string& path,
+    const std::vector<std::string>& extraDefines) const {
+    std::vector<std::string> defines = m_kernelDefines;
+    defines.insert(defines.end(), extraDefines.begin(), extraDefines.end());
+    return compileComputeProgram(ProgramCache::insertDefines(ProgramCache::loadSource(path), defines));
+}
+
+void GpuPhysicsSolver::bindStaticBuffers() const {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kPosBinding, m_posSsboA);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kPosBinding + 1, m_posSsboB);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kVelBinding, m_velSsboA);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kVelBinding + 1, m_velSsboB);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kFixedBinding, m_fixedSsbo);
+}
+
+// Bindings 5-7 are shared with the auxiliary passes, so they are restored before every step dispatch.
+void GpuPhysicsSolver::bindStepBuffers() const {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kHealthBinding, m_healthSsbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kColliderBinding, m_colliderSsbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kSdfBinding, m_sdfSsbo);
+}
+
+void GpuPhysicsSolver::writeDispatchParams(float dt, int substeps, int substepsPerDispatch) {
+    m_paramsRing->beginFrame();
+    GpuSimParams params{};
+    params.rows = static_cast<int>(m_rows);
+    params.cols = static_cast<int>(m_cols);
+    params.numParticles = static_cast<int>(m_rows * m_cols);
+    params.draggedIndex = m_draggedIndex;
+    params.dt = dt;
+    params.spacing = m_spacing;
+    params.mass = m_mass;
+    params.stiffness = m_stiffness;
+    params.damping = m_damping;
+    params.springDamping = m_springDamping;
+    params.maxSpeed = m_maxSpeed;
+    params.groundY = m_groundY;
+    params.gravity = m_gravity;
+    params.colliderCount = m_colliderCount;
+    params.wind = m_wind;
+    params.colliderThickness = m_colliderThickness;
+    params.dragTarget = m_dragTarget;
+    params.colliderFriction = m_colliderFriction;
+    params.tableMask = m_hashTableSize - 1;
+    params.selfCollisionThickness = m_selfCollisionThickness;
+
+    bool flip = m_pingPongFlip;
+    int dispatches = 0;
+    for (int remaining = substeps; remaining > 0; remaining -= substepsPerDispatch) {
+        params.readIndex = flip ? 1 : 0;
+        params.tileSubsteps = std::min(remaining, substepsPerDispatch);
+        m_paramsRing->write(static_cast<std::size_t>(dispatches), params);
+        flip = !flip;
+        ++dispatches;
+    }
+    m_paramsRing->upload(static_cast<std::size_t>(dispatches));
+}
+
+void GpuPhysicsSolver::applyPositionSnapshot() {
+    const unsigned char* bytes = static_cast<const unsigned char*>(m_positionReadback->snapshot());
+    const std::size_t stride = positionStride();
     for (std::size_t i = 0; i < m_positionsCpu.size(); ++i) {
-        m_positionsCpu[i] = glm::vec3(pos4[i]);
+        std::memcpy(&m_positionsCpu[i], bytes + i * stride, sizeof(glm::vec3));
+    }
+    m_positionSerial = m_positionReadback->snapshotSerial();
+}
+
+// Exact bounds of the freshly initialized grid, used until the first GPU reduction lands.
+void GpuPhysicsSolver::resetBounds() {
+    m_boundsMin = m_positionsCpu.front();
+    m_boundsMax = m_positionsCpu.front();
+    for (const glm::vec3& position : m_positionsCpu) {
+        m_boundsMin = glm::min(m_boundsMin, position);
+        m_boundsMax = glm::max(m_boundsMax, position);
     }
+    m_boundsSerial = m_boundsReadback->snapshotSerial();
+    m_boundsStale = false;
 }
 
-std::string GpuPhysicsSolver::loadTextFile(const std::string& path) {
-    std::ifstream file(path);
-    if (!file.is_open()) {
-        throw std::runtime_error("Failed to open file: " + path);
+// Takes whatever copies have finished without waiting; true when a finished health snapshot saw a non-finite value.
+bool GpuPhysicsSolver::collectReadbacks() {
+    m_positionReadback->poll();
+    if (m_positionReadback->hasSnapshot() && m_positionReadback->snapshotSerial() != m_positionSerial) {
+        applyPositionSnapshot();
+    }
+
+    m_boundsReadback->poll();
+    if (m_boundsReadback->hasSnapshot() && m_boundsReadback->snapshotSerial() != m_boundsSerial) {
+        std::uint32_t bits[6];
+        std::memcpy(bits, m_boundsReadback->snapshot(), sizeof(bits));
+        m_boundsMin = glm::vec3(fromOrderedBits(~bits[0]), fromOrderedBits(~bits[1]), fromOrderedBits(~bits[2]));
+        m_boundsMax = glm::vec3(fromOrderedBits(bits[3]), fromOrderedBits(bits[4]), fromOrderedBits(bits[5]));
+        m_boundsSerial = m_boundsReadback->snapshotSerial();
     }
 
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
+    m_healthReadback->poll();
+    if (!m_healthReadback->hasSnapshot() || m_healthReadback->snapshotSerial() == m_healthSerial) {
+        return false;
+    }
+    m_healthSerial = m_healthReadback->snapshotSerial();
+    unsigned int flag = 0;
+    std::memcpy(&flag, m_healthReadback->snapshot(), sizeof(flag));
+    return flag != 0;
 }
 
 unsigned int GpuPhysicsSolver::compileComputeProgram(const std::string& source) {
-    const char* src = source.c_str();
-    const unsigned int shader = glCreateShader(GL_COMPUTE_SHADER);
-    glShaderSource(shader, 1, &src, nullptr);
-    glCompileShader(shader);
-
-    int success = 0;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (success == GL_FALSE) {
-        int logLength = 0;
-        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
-        std::string log(static_cast<std::size_t>(std::max(1, logLength)), '\0');
-        glGetShaderInfoLog(shader, logLength, nullptr, log.data());
-        glDeleteShader(shader);
-        throw std::runtime_error("Compute shader compilation failed: " + log);
-    }
-
-    const unsigned int program = glCreateProgram();
-    glAttachShader(program, shader);
-    glLinkProgram(program);
-    glDeleteShader(shader);
-
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
-    if (success == GL_FALSE) {
-        int logLength = 0;
-        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
-        std::string log(static_cast<std::size_t>(std::max(1, logLength)), '\0');
-        glGetProgramInfoLog(program, logLength, nullptr, log.data());
-        glDeleteProgram(program);
-        throw std::runtime_error("Compute program link failed: " + log);
-    }
-
-    return program;
+    return ProgramCache::build({{GL_COMPUTE_SHADER, source}});
 }
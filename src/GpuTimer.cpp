@@ -0,0 +1,76 @@
+#include "GpuTimer.h"
+
+#include <stdexcept>
+
+#include <GL/glew.h>
+
+GpuTimer::GpuTimer(std::size_t sectionCount, std::size_t latency)
+    : m_sectionCount(sectionCount),
+      m_latency(latency),
+      m_queries(sectionCount * latency, 0),
+      m_issued(sectionCount * latency, 0),
+      m_milliseconds(sectionCount, 0.0),
+      m_slot(0),
+      m_active(false) {
+    if (sectionCount == 0 || latency == 0) {
+        throw std::runtime_error("GpuTimer requires at least one section and one frame slot");
+    }
+    glGenQueries(static_cast<GLsizei>(m_queries.size()), m_queries.data());
+}
+
+GpuTimer::~GpuTimer() {
+    if (!m_queries.empty() && m_queries[0] != 0) {
+        glDeleteQueries(static_cast<GLsizei>(m_queries.size()), m_queries.data());
+    }
+}
+
+void GpuTimer::beginFrame() {
+    if (m_active) {
+        throw std::runtime_error("GpuTimer::beginFrame called inside a timed section");
+    }
+
+    m_slot = (m_slot + 1) % m_latency;
+    const std::size_t base = m_slot * m_sectionCount;
+    for (std::size_t section = 0; section < m_sectionCount; ++section) {
+        if (m_issued[base + section] == 0) {
+            m_milliseconds[section] = 0.0;
+            continue;
+        }
+
+        // A result that is still pending is dropped rather than waited for; the previous value stays.
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(m_queries[base + section], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == GL_TRUE) {
+            GLuint64 elapsedNs = 0;
+            glGetQueryObjectui64v(m_queries[base + section], GL_QUERY_RESULT, &elapsedNs);
+            m_milliseconds[section] = static_cast<double>(elapsedNs) * 1e-6;
+        }
+        m_issued[base + section] = 0;
+    }
+}
+
+void GpuTimer::begin(std::size_t section) {
+    if (section >= m_sectionCount) {
+        throw std::runtime_error("GpuTimer section out of range");
+    }
+    if (m_active) {
+        throw std::runtime_error("GpuTimer sections cannot nest");
+    }
+
+    const std::size_t query = m_slot * m_sectionCount + section;
+    glBeginQuery(GL_TIME_ELAPSED, m_queries[query]);
+    m_issued[query] = 1;
+    m_active = true;
+}
+
+void GpuTimer::end() {
+    if (!m_active) {
+        throw std::runtime_error("GpuTimer::end without a matching begin");
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    m_active = false;
+}
+
+double GpuTimer::milliseconds(std::size_t section) const {
+    return section < m_sectionCount ? m_milliseconds[section] : 0.0;
+}
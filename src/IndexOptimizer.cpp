@@ -0,0 +1,339 @@
+#include "IndexOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "Hash.h"
+
+namespace {
+constexpr int kCacheSize = 32;
+constexpr float kCacheDecayPower = 1.5f;
+constexpr float kLastTriangleScore = 0.75f;
+constexpr float kValenceBoostScale = 2.0f;
+constexpr float kValenceBoostPower = 0.5f;
+// Valence beyond this shares one boost value.
+constexpr unsigned int kMaxValence = 32;
+// Cache model for the overdraw clustering; smaller than the one optimizeVertexCache orders for, so clusters
+// are only cut where even older hardware would have lost its cache.
+constexpr std::size_t kFifoCacheSize = 16;
+constexpr unsigned int kEmptySlot = std::numeric_limits<unsigned int>::max();
+
+struct ScoreTable {
+    float cache[kCacheSize];
+    float valence[kMaxValence + 1];
+
+    ScoreTable() {
+        for (int i = 0; i < kCacheSize; ++i) {
+            // The three vertices of the triangle just drawn are scored flat so the next one does not simply
+            // reuse the same edge and strip along it.
+            cache[i] = i < 3 ? kLastTriangleScore
+                             : std::pow(1.0f - static_cast<float>(i - 3) / (kCacheSize - 3), kCacheDecayPower);
+        }
+        valence[0] = 0.0f;
+        for (unsigned int i = 1; i <= kMaxValence; ++i) {
+            valence[i] = kValenceBoostScale * std::pow(static_cast<float>(i), -kValenceBoostPower);
+        }
+    }
+};
+
+float vertexScore(const ScoreTable& table, int cachePosition, unsigned int remaining) {
+    if (remaining == 0) {
+        return -1.0f;
+    }
+    const float cacheScore = cachePosition >= 0 ? table.cache[cachePosition] : 0.0f;
+    return cacheScore + table.valence[std::min(remaining, kMaxValence)];
+}
+
+void checkIndices(const std::vector<unsigned int>& indices, std::size_t vertexCount) {
+    if (indices.size() % 3 != 0) {
+        throw std::runtime_error("IndexOptimizer expects a triangle list");
+    }
+    for (const unsigned int index : indices) {
+        if (index >= vertexCount) {
+            throw std::runtime_error("IndexOptimizer index out of range");
+        }
+    }
+}
+
+// Misses per triangle under a FIFO cache; a vertex already cached does not move.
+class FifoCache {
+public:
+    FifoCache(std::size_t vertexCount, std::size_t cacheSize)
+        : m_cacheSize(cacheSize), m_time(cacheSize + 1), m_stamp(vertexCount, 0) {}
+
+    void clear() { m_time += m_cacheSize + 1; }
+
+    unsigned int triangleMisses(const unsigned int* corners) {
+        unsigned int misses = 0;
+        for (int k = 0; k < 3; ++k) {
+            if (m_time - m_stamp[corners[k]] > m_cacheSize) {
+                m_stamp[corners[k]] = m_time++;
+                ++misses;
+            }
+        }
+        return misses;
+    }
+
+private:
+    std::size_t m_cacheSize;
+    std::size_t m_time;
+    std::vector<std::size_t> m_stamp;
+};
+}  // namespace
+
+void IndexOptimizer::optimizeVertexCache(std::vector<unsigned int>& indices, std::size_t vertexCount) {
+    checkIndices(indices, vertexCount);
+    const std::size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+    static const ScoreTable table;
+
+    // Triangles per vertex as CSR; the live prefix of each list shrinks as triangles are emitted.
+    std::vector<unsigned int> offsets(vertexCount + 1, 0);
+    for (const unsigned int index : indices) {
+        ++offsets[index + 1];
+    }
+    for (std::size_t v = 0; v < vertexCount; ++v) {
+        offsets[v + 1] += offsets[v];
+    }
+    std::vector<unsigned int> remaining(vertexCount);
+    for (std::size_t v = 0; v < vertexCount; ++v) {
+        remaining[v] = offsets[v + 1] - offsets[v];
+    }
+    std::vector<unsigned int> adjacency(indices.size());
+    {
+        std::vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+        for (std::size_t i = 0; i < indices.size(); ++i) {
+            adjacency[cursor[indices[i]]++] = static_cast<unsigned int>(i / 3);
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> score(vertexCount);
+    for (std::size_t v = 0; v < vertexCount; ++v) {
+        score[v] = vertexScore(table, -1, remaining[v]);
+    }
+    std::vector<float> triangleScore(triangleCount);
+    for (std::size_t t = 0; t < triangleCount; ++t) {
+        triangleScore[t] = score[indices[3 * t]] + score[indices[3 * t + 1]] + score[indices[3 * t + 2]];
+    }
+    std::vector<bool> drawn(triangleCount, false);
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    unsigned int cache[kCacheSize];
+    int cacheCount = 0;
+    std::size_t scanCursor = 0;
+    std::size_t best = 0;
+
+    for (std::size_t emitted = 0; emitted < triangleCount; ++emitted) {
+        const unsigned int* corners = &indices[3 * best];
+        drawn[best] = true;
+        result.insert(result.end(), corners, corners + 3);
+
+        // Move the triangle's vertices to the front of the LRU cache and drop it from their live lists. A
+        // corner repeated in a degenerate triangle is listed once per occurrence but cached once.
+        unsigned int next[kCacheSize + 3];
+        int nextCount = 0;
+        for (int k = 0; k < 3; ++k) {
+            const unsigned int v = corners[k];
+            unsigned int* live = &adjacency[offsets[v]];
+            for (unsigned int e = 0; e < remaining[v]; ++e) {
+                if (live[e] == best) {
+                    std::swap(live[e], live[remaining[v] - 1]);
+                    break;
+                }
+            }
+            --remaining[v];
+            if (std::find(next, next + nextCount, v) == next + nextCount) {
+                next[nextCount++] = v;
+            }
+        }
+        for (int i = 0; i < cacheCount; ++i) {
+            const unsigned int v = cache[i];
+            if (v != corners[0] && v != corners[1] && v != corners[2]) {
+                next[nextCount++] = v;
+            }
+        }
+
+        // Rescore everything whose cache position changed, including vertices that just fell out, and find
+        // the best triangle touching the cache.
+        for (int i = 0; i < nextCount; ++i) {
+            const unsigned int v = next[i];
+            cachePosition[v] = i < kCacheSize ? i : -1;
+            const float newScore = vertexScore(table, cachePosition[v], remaining[v]);
+            const float delta = newScore - score[v];
+            score[v] = newScore;
+            for (unsigned int e = 0; e < remaining[v]; ++e) {
+                triangleScore[adjacency[offsets[v] + e]] += delta;
+            }
+        }
+        cacheCount = std::min(nextCount, kCacheSize);
+        for (int i = 0; i < cacheCount; ++i) {
+            cache[i] = next[i];
+        }
+
+        float bestScore = -1.0f;
+        for (int i = 0; i < cacheCount; ++i) {
+            const unsigned int v = cache[i];
+            for (unsigned int e = 0; e < remaining[v]; ++e) {
+                const unsigned int t = adjacency[offsets[v] + e];
+                if (triangleScore[t] > bestScore) {
+                    bestScore = triangleScore[t];
+                    best = t;
+                }
+            }
+        }
+        if (bestScore < 0.0f) {
+            // Nothing left next to the cache: continue with the first triangle not yet drawn.
+            while (scanCursor < triangleCount && drawn[scanCursor]) {
+                ++scanCursor;
+            }
+            best = scanCursor;
+        }
+    }
+
+    indices = std::move(result);
+}
+
+void IndexOptimizer::optimizeOverdraw(
+    std::vector<unsigned int>& indices,
+    const std::vector<glm::vec3>& positions,
+    float threshold) {
+    checkIndices(indices, positions.size());
+    const std::size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2) {
+        return;
+    }
+
+    // Hard boundaries: triangles that miss on all three corners start a cluster for free.
+    FifoCache cache(positions.size(), kFifoCacheSize);
+    std::vector<std::size_t> hardStarts(1, 0);
+    for (std::size_t t = 0; t < triangleCount; ++t) {
+        if (cache.triangleMisses(&indices[3 * t]) == 3 && t > 0) {
+            hardStarts.push_back(t);
+        }
+    }
+    hardStarts.push_back(triangleCount);
+
+    // Soft boundaries: inside a hard cluster, cut wherever the running miss ratio (from a cold cache) is
+    // already within `threshold` of the whole cluster's.
+    std::vector<std::size_t> clusterStarts;
+    for (std::size_t h = 0; h + 1 < hardStarts.size(); ++h) {
+        const std::size_t begin = hardStarts[h];
+        const std::size_t end = hardStarts[h + 1];
+        cache.clear();
+        unsigned int clusterMisses = 0;
+        for (std::size_t t = begin; t < end; ++t) {
+            clusterMisses += cache.triangleMisses(&indices[3 * t]);
+        }
+        const float clusterRatio = static_cast<float>(clusterMisses) / static_cast<float>(end - begin);
+
+        std::size_t start = begin;
+        unsigned int misses = 0;
+        cache.clear();
+        clusterStarts.push_back(begin);
+        for (std::size_t t = begin; t + 1 < end; ++t) {
+            misses += cache.triangleMisses(&indices[3 * t]);
+            const float runningRatio = static_cast<float>(misses) / static_cast<float>(t + 1 - start);
+            if (runningRatio <= clusterRatio * threshold) {
+                start = t + 1;
+                misses = 0;
+                cache.clear();
+                clusterStarts.push_back(start);
+            }
+        }
+    }
+    clusterStarts.push_back(triangleCount);
+
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    const std::size_t clusterCount = clusterStarts.size() - 1;
+    std::vector<float> sortKey(clusterCount);
+    std::vector<glm::vec3> clusterCentroid(clusterCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormal(clusterCount, glm::vec3(0.0f));
+    for (std::size_t c = 0; c < clusterCount; ++c) {
+        float area = 0.0f;
+        for (std::size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t) {
+            const glm::vec3& a = positions[indices[3 * t]];
+            const glm::vec3& b = positions[indices[3 * t + 1]];
+            const glm::vec3& d = positions[indices[3 * t + 2]];
+            const glm::vec3 n = glm::cross(b - a, d - a);
+            const float triangleArea = glm::length(n);
+            clusterCentroid[c] += (a + b + d) * (triangleArea / 3.0f);
+            clusterNormal[c] += n;
+            area += triangleArea;
+        }
+        meshCentroid += clusterCentroid[c];
+        meshArea += area;
+        clusterCentroid[c] = area > 0.0f ? clusterCentroid[c] / area : positions[indices[3 * clusterStarts[c]]];
+    }
+    meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : glm::vec3(0.0f);
+
+    for (std::size_t c = 0; c < clusterCount; ++c) {
+        const float normalLength = glm::length(clusterNormal[c]);
+        const glm::vec3 normal = normalLength > 0.0f ? clusterNormal[c] / normalLength : glm::vec3(0.0f);
+        sortKey[c] = glm::dot(clusterCentroid[c] - meshCentroid, normal);
+    }
+
+    std::vector<std::size_t> order(clusterCount);
+    for (std::size_t c = 0; c < clusterCount; ++c) {
+        order[c] = c;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return sortKey[a] > sortKey[b]; });
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (const std::size_t c : order) {
+        result.insert(result.end(), indices.begin() + 3 * clusterStarts[c], indices.begin() + 3 * clusterStarts[c + 1]);
+    }
+    indices = std::move(result);
+}
+
+float IndexOptimizer::averageCacheMissRatio(
+    const std::vector<unsigned int>& indices,
+    std::size_t vertexCount,
+    std::size_t cacheSize) {
+    checkIndices(indices, vertexCount);
+    if (indices.empty()) {
+        return 0.0f;
+    }
+    FifoCache cache(vertexCount, cacheSize);
+    unsigned int misses = 0;
+    for (std::size_t i = 0; i < indices.size(); i += 3) {
+        misses += cache.triangleMisses(&indices[i]);
+    }
+    return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+}
+
+// Open addressing over an FNV-1a hash of each vertex's bytes; the first occurrence keeps its relative order.
+std::vector<unsigned int> IndexOptimizer::weldRemap(const void* vertices, std::size_t vertexCount, std::size_t stride) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(vertices);
+    std::size_t tableSize = 1;
+    while (tableSize < vertexCount * 2) {
+        tableSize <<= 1;
+    }
+    std::vector<unsigned int> table(tableSize, kEmptySlot);
+    std::vector<unsigned int> remap(vertexCount);
+    unsigned int uniqueCount = 0;
+
+    for (std::size_t i = 0; i < vertexCount; ++i) {
+        const unsigned char* vertex = bytes + i * stride;
+        std::size_t slot = static_cast<std::size_t>(fnv1a64(vertex, stride)) & (tableSize - 1);
+        while (table[slot] != kEmptySlot && std::memcmp(bytes + table[slot] * stride, vertex, stride) != 0) {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        if (table[slot] == kEmptySlot) {
+            table[slot] = static_cast<unsigned int>(i);
+            remap[i] = uniqueCount++;
+        } else {
+            remap[i] = remap[table[slot]];
+        }
+    }
+    return remap;
+}
@@ -1,85 +1,291 @@
 #include "Mesh.h"
 
+#include <cstddef>
+#include <cstring>
 #include <stdexcept>
 #include <utility>
 
 #include <GL/glew.h>
 
+#include "Geometry.h"
+#include "IndexOptimizer.h"
+#include "ThreadPool.h"
+
+namespace {
+constexpr std::size_t kNormalRowGrain = 8;
+constexpr std::size_t kNormalVertexGrain = 1024;
+constexpr std::size_t kMaxShortIndexVertices = 65536;
+constexpr unsigned int kInstanceModelLocation = 2;
+constexpr unsigned int kInstanceNormalLocation = 6;
+constexpr unsigned int kInstanceMaterialLocation = 9;
+
+// One-ring of a grid vertex in buildIndexBuffer's triangulation (quads split along the (r, c+1)-(r+1, c)
+// diagonal) as (dr, dc), in winding order: each consecutive pair spans one incident triangle.
+constexpr int kGridRing[6][2] = {{0, 1}, {-1, 1}, {-1, 0}, {0, -1}, {1, -1}, {1, 0}};
+
+// Unnormalized normal of a grid border vertex: only ring pairs with both neighbours inside the grid form a
+// triangle.
+glm::vec3 gridBorderNormal(
+    const glm::vec3* positions,
+    std::size_t rows,
+    std::size_t cols,
+    std::size_t r,
+    std::size_t c) {
+    const long rowCount = static_cast<long>(rows);
+    const long colCount = static_cast<long>(cols);
+    const auto inside = [&](const int* offset) {
+        const long nr = static_cast<long>(r) + offset[0];
+        const long nc = static_cast<long>(c) + offset[1];
+        return nr >= 0 && nr < rowCount && nc >= 0 && nc < colCount;
+    };
+    const auto neighbour = [&](const int* offset) {
+        return positions[(static_cast<long>(r) + offset[0]) * colCount + static_cast<long>(c) + offset[1]];
+    };
+
+    const glm::vec3 p = positions[r * cols + c];
+    glm::vec3 n(0.0f);
+    for (int k = 0; k < 6; ++k) {
+        const int* a = kGridRing[k];
+        const int* b = kGridRing[(k + 1) % 6];
+        if (inside(a) && inside(b)) {
+            n += glm::cross(neighbour(a) - p, neighbour(b) - p);
+        }
+    }
+    return n;
+}
+}  // namespace
+
 Mesh::Mesh(std::size_t rows, std::size_t cols, const std::vector<glm::vec3>& positions)
-    : m_rows(rows), m_cols(cols), m_dynamicPositions(true), m_vao(0), m_vbo(0), m_ebo(0) {
+    : m_rows(rows),
+      m_cols(cols),
+      m_vertexCount(positions.size()),
+      m_positions(positions),
+      m_normals(positions.size(), 0),
+      m_indexType(0),
+      m_dynamicPositions(true),
+      m_vao(0),
+      m_depthVao(0),
+      m_vbo(0),
+      m_ebo(0),
+      m_externalVao(0),
+      m_externalDepthVao(0),
+      m_externalPositions(0),
+      m_externalNormals(0),
+      m_externalPositionStride(0),
+      m_instanceBuffer(0),
+      m_boundsMin(0.0f),
+      m_boundsMax(0.0f),
+      m_ringMapped(nullptr),
+      m_ringSlot(0),
+      m_ringFences{} {
     if (rows * cols != positions.size()) {
         throw std::runtime_error("Mesh positions size mismatch with rows*cols");
     }
 
-    m_vertices.resize(positions.size());
-    for (std::size_t i = 0; i < positions.size(); ++i) {
-        m_vertices[i].position = positions[i];
-        m_vertices[i].normal = glm::vec3(0.0f, 1.0f, 0.0f);
-    }
-
     buildIndexBuffer();
-    recomputeNormals();
-
-    glGenVertexArrays(1, &m_vao);
-    glGenBuffers(1, &m_vbo);
-    glGenBuffers(1, &m_ebo);
+    recomputeNormals(m_positions.data(), m_normals.data());
+    computeBounds();
 
+    createVertexArrays();
     uploadToGpu(false);
 }
 
-Mesh::Mesh(std::vector<MeshVertex> vertices, std::vector<unsigned int> indices, bool dynamicPositions)
+Mesh::Mesh(const std::vector<MeshVertex>& vertices, std::vector<unsigned int> indices, bool dynamicPositions)
     : m_rows(0),
       m_cols(0),
-      m_vertices(std::move(vertices)),
+      m_vertexCount(vertices.size()),
       m_indices(std::move(indices)),
+      m_indexType(0),
       m_dynamicPositions(dynamicPositions),
       m_vao(0),
+      m_depthVao(0),
       m_vbo(0),
-      m_ebo(0) {
-    if (m_vertices.empty() || m_indices.empty()) {
+      m_ebo(0),
+      m_externalVao(0),
+      m_externalDepthVao(0),
+      m_externalPositions(0),
+      m_externalNormals(0),
+      m_externalPositionStride(0),
+      m_instanceBuffer(0),
+      m_boundsMin(0.0f),
+      m_boundsMax(0.0f),
+      m_ringMapped(nullptr),
+      m_ringSlot(0),
+      m_ringFences{} {
+    if (vertices.empty() || m_indices.empty()) {
         throw std::runtime_error("Mesh vertices/indices must not be empty");
     }
 
-    glGenVertexArrays(1, &m_vao);
-    glGenBuffers(1, &m_vbo);
-    glGenBuffers(1, &m_ebo);
+    m_positions.reserve(vertices.size());
+    m_normals.reserve(vertices.size());
+    for (const MeshVertex& vertex : vertices) {
+        m_positions.push_back(vertex.position);
+        m_normals.push_back(packOctahedralNormal(vertex.normal));
+    }
+
+    if (m_dynamicPositions) {
+        buildVertexTriangleIndex();
+    }
+    computeBounds();
+
+    createVertexArrays();
     uploadToGpu(false);
 }
 
 Mesh::~Mesh() {
+    for (void* fence : m_ringFences) {
+        if (fence != nullptr) {
+            glDeleteSync(static_cast<GLsync>(fence));
+        }
+    }
+    const unsigned int vertexArrays[] = {m_externalDepthVao, m_externalVao, m_depthVao, m_vao};
+    for (const unsigned int vertexArray : vertexArrays) {
+        if (vertexArray != 0) {
+            glDeleteVertexArrays(1, &vertexArray);
+        }
+    }
     if (m_ebo != 0) {
         glDeleteBuffers(1, &m_ebo);
     }
     if (m_vbo != 0) {
+        if (m_ringMapped != nullptr) {
+            glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
         glDeleteBuffers(1, &m_vbo);
     }
-    if (m_vao != 0) {
-        glDeleteVertexArrays(1, &m_vao);
-    }
 }
 
 void Mesh::updatePositions(const std::vector<glm::vec3>& positions) {
     if (!m_dynamicPositions) {
         throw std::runtime_error("updatePositions is only supported for dynamic meshes");
     }
-    if (positions.size() != m_vertices.size()) {
+    if (positions.size() != m_vertexCount) {
         throw std::runtime_error("updatePositions size mismatch");
     }
 
-    for (std::size_t i = 0; i < positions.size(); ++i) {
-        m_vertices[i].position = positions[i];
+    if (m_ringMapped != nullptr) {
+        unsigned char* slot = acquireRingSlot();
+        const std::size_t positionBytes = m_vertexCount * sizeof(glm::vec3);
+        std::memcpy(slot, positions.data(), positionBytes);
+        recomputeNormals(positions.data(), reinterpret_cast<std::uint32_t*>(slot + positionBytes));
+        bindVertexSlot(m_ringSlot);
+        return;
     }
 
-    recomputeNormals();
+    m_positions = positions;
+    recomputeNormals(m_positions.data(), m_normals.data());
     uploadToGpu(true);
 }
 
+void Mesh::setExternalStreams(unsigned int positionBuffer, unsigned int normalBuffer, std::size_t positionStride) {
+    if (positionBuffer == m_externalPositions && normalBuffer == m_externalNormals &&
+        positionStride == m_externalPositionStride) {
+        return;
+    }
+    m_externalPositions = positionBuffer;
+    m_externalNormals = normalBuffer;
+    m_externalPositionStride = positionStride;
+    if (positionBuffer == 0 || normalBuffer == 0) {
+        m_externalPositions = 0;
+        m_externalNormals = 0;
+        return;
+    }
+
+    if (m_externalVao == 0) {
+        glGenVertexArrays(1, &m_externalVao);
+        glGenVertexArrays(1, &m_externalDepthVao);
+    }
+
+    const GLsizei stride = static_cast<GLsizei>(positionStride);
+    glBindVertexArray(m_externalVao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+    glBindBuffer(GL_ARRAY_BUFFER, positionBuffer);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(0));
+    glEnableVertexAttribArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, normalBuffer);
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(std::uint32_t), reinterpret_cast<void*>(0));
+    glEnableVertexAttribArray(1);
+
+    glBindVertexArray(m_externalDepthVao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+    glBindBuffer(GL_ARRAY_BUFFER, positionBuffer);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(0));
+    glEnableVertexAttribArray(0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+void Mesh::setInstanceStream(unsigned int buffer, std::size_t mainOffset, std::size_t depthOffset) {
+    m_instanceBuffer = buffer;
+    bindInstanceAttributes(m_vao, mainOffset, false);
+    bindInstanceAttributes(m_depthVao, depthOffset, true);
+}
+
 void Mesh::draw() const {
+    glBindVertexArray(m_externalPositions != 0 ? m_externalVao : m_vao);
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_indices.size()), m_indexType, nullptr);
+    glBindVertexArray(0);
+}
+
+void Mesh::drawInstanced(std::size_t instanceCount) const {
     glBindVertexArray(m_vao);
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_indices.size()), GL_UNSIGNED_INT, nullptr);
+    glDrawElementsInstanced(
+        GL_TRIANGLES,
+        static_cast<GLsizei>(m_indices.size()),
+        m_indexType,
+        nullptr,
+        static_cast<GLsizei>(instanceCount));
     glBindVertexArray(0);
 }
 
+void Mesh::drawDepth() const {
+    glBindVertexArray(m_externalPositions != 0 ? m_externalDepthVao : m_depthVao);
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_indices.size()), m_indexType, nullptr);
+    glBindVertexArray(0);
+}
+
+void Mesh::drawDepthInstanced(std::size_t instanceCount) const {
+    glBindVertexArray(m_depthVao);
+    glDrawElementsInstanced(
+        GL_TRIANGLES,
+        static_cast<GLsizei>(m_indices.size()),
+        m_indexType,
+        nullptr,
+        static_cast<GLsizei>(instanceCount));
+    glBindVertexArray(0);
+}
+
+const glm::vec3& Mesh::boundsMin() const {
+    return m_boundsMin;
+}
+
+const glm::vec3& Mesh::boundsMax() const {
+    return m_boundsMax;
+}
+
+// Generic attribute values are context state rather than VAO state, so they hold for every later draw whose
+// VAO leaves these locations disabled.
+void Mesh::setCurrentInstance(const MeshInstance& instance) {
+    for (unsigned int column = 0; column < 4; ++column) {
+        glVertexAttrib4fv(kInstanceModelLocation + column, &instance.model[column][0]);
+    }
+    for (unsigned int column = 0; column < 3; ++column) {
+        glVertexAttrib3fv(kInstanceNormalLocation + column, &instance.normalMatrix[column][0]);
+    }
+    glVertexAttribI1ui(kInstanceMaterialLocation, instance.materialIndex);
+}
+
+MeshInstance Mesh::makeInstance(const glm::mat4& model, std::uint32_t materialIndex) {
+    MeshInstance instance;
+    instance.model = model;
+    instance.normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+    instance.materialIndex = materialIndex;
+    return instance;
+}
+
 void Mesh::buildIndexBuffer() {
     m_indices.clear();
     m_indices.reserve((m_rows - 1) * (m_cols - 1) * 6);
@@ -100,67 +306,267 @@ void Mesh::buildIndexBuffer() {
             m_indices.push_back(i3);
         }
     }
+
+    IndexOptimizer::optimizeVertexCache(m_indices, m_vertexCount);
 }
 
-void Mesh::recomputeNormals() {
-    for (auto& v : m_vertices) {
-        v.normal = glm::vec3(0.0f);
+void Mesh::buildVertexTriangleIndex() {
+    const std::size_t vertexCount = m_vertexCount;
+    const std::size_t triangleCount = m_indices.size() / 3;
+    m_vertexTriangleOffsets.assign(vertexCount + 1, 0);
+    for (std::size_t i = 0; i < triangleCount * 3; ++i) {
+        if (m_indices[i] >= vertexCount) {
+            throw std::runtime_error("Mesh index out of range");
+        }
+        ++m_vertexTriangleOffsets[m_indices[i] + 1];
+    }
+    for (std::size_t v = 0; v < vertexCount; ++v) {
+        m_vertexTriangleOffsets[v + 1] += m_vertexTriangleOffsets[v];
     }
 
-    for (std::size_t i = 0; i < m_indices.size(); i += 3) {
-        MeshVertex& a = m_vertices[m_indices[i + 0]];
-        MeshVertex& b = m_vertices[m_indices[i + 1]];
-        MeshVertex& c = m_vertices[m_indices[i + 2]];
+    m_vertexTriangles.resize(m_vertexTriangleOffsets[vertexCount]);
+    std::vector<unsigned int> cursor(m_vertexTriangleOffsets.begin(), m_vertexTriangleOffsets.end() - 1);
+    for (std::size_t i = 0; i < triangleCount * 3; ++i) {
+        m_vertexTriangles[cursor[m_indices[i]]++] = static_cast<unsigned int>(i / 3);
+    }
+    m_faceNormals.resize(triangleCount);
+}
 
-        const glm::vec3 e1 = b.position - a.position;
-        const glm::vec3 e2 = c.position - a.position;
-        const glm::vec3 n = glm::cross(e1, e2);
+// Area-weighted vertex normals: the sum of the incident triangles' cross products, normalized.
+void Mesh::recomputeNormals(const glm::vec3* positions, std::uint32_t* out) {
+    if (m_rows > 0) {
+        recomputeGridNormals(positions, out);
+    } else {
+        recomputeIndexedNormals(positions, out);
+    }
+}
+
+// Gathers each vertex's six incident triangles straight from its grid neighbours, so every vertex is written
+// once and rows run in parallel. Interior vertices take a branch-free path.
+void Mesh::recomputeGridNormals(const glm::vec3* positions, std::uint32_t* out) {
+    const std::size_t rows = m_rows;
+    const std::size_t cols = m_cols;
+
+    ThreadPool::shared().parallelFor(0, rows, kNormalRowGrain, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t r = begin; r < end; ++r) {
+            const glm::vec3* row = positions + r * cols;
+            std::uint32_t* outRow = out + r * cols;
+            if (r == 0 || r + 1 == rows) {
+                for (std::size_t c = 0; c < cols; ++c) {
+                    outRow[c] = packOctahedralNormal(gridBorderNormal(positions, rows, cols, r, c));
+                }
+                continue;
+            }
+
+            const glm::vec3* above = row - cols;
+            const glm::vec3* below = row + cols;
+            outRow[0] = packOctahedralNormal(gridBorderNormal(positions, rows, cols, r, 0));
+            for (std::size_t c = 1; c + 1 < cols; ++c) {
+                const glm::vec3 p = row[c];
+                const glm::vec3 d0 = row[c + 1] - p;
+                const glm::vec3 d1 = above[c + 1] - p;
+                const glm::vec3 d2 = above[c] - p;
+                const glm::vec3 d3 = row[c - 1] - p;
+                const glm::vec3 d4 = below[c - 1] - p;
+                const glm::vec3 d5 = below[c] - p;
+                outRow[c] = packOctahedralNormal(
+                    glm::cross(d0, d1) + glm::cross(d1, d2) + glm::cross(d2, d3) + glm::cross(d3, d4) +
+                    glm::cross(d4, d5) + glm::cross(d5, d0));
+            }
+            outRow[cols - 1] = packOctahedralNormal(gridBorderNormal(positions, rows, cols, r, cols - 1));
+        }
+    });
+}
+
+// Face normals in one parallel pass, then a per-vertex gather over the CSR incidence lists; no two threads
+// write the same element.
+void Mesh::recomputeIndexedNormals(const glm::vec3* positions, std::uint32_t* out) {
+    if (m_faceNormals.size() != m_indices.size() / 3) {
+        buildVertexTriangleIndex();
+    }
 
-        a.normal += n;
-        b.normal += n;
-        c.normal += n;
+    const std::size_t faceCount = m_faceNormals.size();
+    ThreadPool::shared().parallelFor(0, faceCount, kNormalVertexGrain, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t t = begin; t < end; ++t) {
+            const glm::vec3 a = positions[m_indices[3 * t + 0]];
+            const glm::vec3 b = positions[m_indices[3 * t + 1]];
+            const glm::vec3 c = positions[m_indices[3 * t + 2]];
+            m_faceNormals[t] = glm::cross(b - a, c - a);
+        }
+    });
+
+    ThreadPool::shared().parallelFor(0, m_vertexCount, kNormalVertexGrain, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t v = begin; v < end; ++v) {
+            glm::vec3 n(0.0f);
+            for (unsigned int e = m_vertexTriangleOffsets[v]; e < m_vertexTriangleOffsets[v + 1]; ++e) {
+                n += m_faceNormals[m_vertexTriangles[e]];
+            }
+            out[v] = packOctahedralNormal(n);
+        }
+    });
+}
+
+void Mesh::createVertexArrays() {
+    glGenVertexArrays(1, &m_vao);
+    glGenVertexArrays(1, &m_depthVao);
+    glGenBuffers(1, &m_vbo);
+    glGenBuffers(1, &m_ebo);
+}
+
+void Mesh::uploadToGpu(bool dynamicOnly) {
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+
+    const std::size_t bytes = slotBytes();
+    const std::size_t positionBytes = m_vertexCount * sizeof(glm::vec3);
+    const std::size_t normalBytes = m_vertexCount * sizeof(std::uint32_t);
+    if (!dynamicOnly && m_dynamicPositions && (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage)) {
+        const GLsizeiptr ringBytes = static_cast<GLsizeiptr>(bytes * kRingFrames);
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, ringBytes, nullptr, flags);
+        m_ringMapped = glMapBufferRange(GL_ARRAY_BUFFER, 0, ringBytes, flags);
+        if (m_ringMapped != nullptr) {
+            for (std::size_t slot = 0; slot < kRingFrames; ++slot) {
+                unsigned char* base = static_cast<unsigned char*>(m_ringMapped) + slot * bytes;
+                std::memcpy(base, m_positions.data(), positionBytes);
+                std::memcpy(base + positionBytes, m_normals.data(), normalBytes);
+            }
+        } else {
+            // Immutable storage cannot be respecified, so the fallback needs a fresh buffer.
+            glDeleteBuffers(1, &m_vbo);
+            glGenBuffers(1, &m_vbo);
+            glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+        }
+    }
+    if (m_ringMapped == nullptr) {
+        glBufferData(
+            GL_ARRAY_BUFFER,
+            static_cast<GLsizeiptr>(bytes),
+            nullptr,
+            m_dynamicPositions ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(positionBytes), m_positions.data());
+        glBufferSubData(
+            GL_ARRAY_BUFFER,
+            static_cast<GLintptr>(positionBytes),
+            static_cast<GLsizeiptr>(normalBytes),
+            m_normals.data());
     }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-    for (auto& v : m_vertices) {
-        const float len = glm::length(v.normal);
-        if (len > 1e-6f) {
-            v.normal /= len;
+    if (!dynamicOnly) {
+        const unsigned int vertexArrays[] = {m_vao, m_depthVao};
+        for (const unsigned int vertexArray : vertexArrays) {
+            glBindVertexArray(vertexArray);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+        }
+        if (m_vertexCount <= kMaxShortIndexVertices) {
+            const std::vector<std::uint16_t> shortIndices(m_indices.begin(), m_indices.end());
+            m_indexType = GL_UNSIGNED_SHORT;
+            glBufferData(
+                GL_ELEMENT_ARRAY_BUFFER,
+                static_cast<GLsizeiptr>(shortIndices.size() * sizeof(std::uint16_t)),
+                shortIndices.data(),
+                GL_STATIC_DRAW);
         } else {
-            v.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+            m_indexType = GL_UNSIGNED_INT;
+            glBufferData(
+                GL_ELEMENT_ARRAY_BUFFER,
+                static_cast<GLsizeiptr>(m_indices.size() * sizeof(unsigned int)),
+                m_indices.data(),
+                GL_STATIC_DRAW);
         }
+        glBindVertexArray(0);
+        bindVertexSlot(0);
     }
 }
 
-void Mesh::uploadToGpu(bool dynamicOnly) {
-    glBindVertexArray(m_vao);
+std::size_t Mesh::slotBytes() const {
+    return m_vertexCount * (sizeof(glm::vec3) + sizeof(std::uint32_t));
+}
 
+// Everything drawn from the current slot has been submitted by the time the next positions arrive, so the
+// slot is fenced and the ring moves on, waiting only if the GPU is still kRingFrames frames behind.
+unsigned char* Mesh::acquireRingSlot() {
+    m_ringFences[m_ringSlot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_ringSlot = (m_ringSlot + 1) % kRingFrames;
+
+    if (m_ringFences[m_ringSlot] != nullptr) {
+        const GLsync fence = static_cast<GLsync>(m_ringFences[m_ringSlot]);
+        GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        while (status == GL_TIMEOUT_EXPIRED) {
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        }
+        glDeleteSync(fence);
+        m_ringFences[m_ringSlot] = nullptr;
+    }
+
+    return static_cast<unsigned char*>(m_ringMapped) + m_ringSlot * slotBytes();
+}
+
+// Points both VAOs at one copy of the streams; slot 0 is the only one without a ring. The depth VAO never
+// enables the normal stream.
+void Mesh::bindVertexSlot(std::size_t slot) {
+    const std::size_t positionBase = slot * slotBytes();
+    const std::size_t normalBase = positionBase + m_vertexCount * sizeof(glm::vec3);
     glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-    glBufferData(
-        GL_ARRAY_BUFFER,
-        static_cast<GLsizeiptr>(m_vertices.size() * sizeof(MeshVertex)),
-        m_vertices.data(),
-        m_dynamicPositions ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
 
-    if (!dynamicOnly) {
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
-        glBufferData(
-            GL_ELEMENT_ARRAY_BUFFER,
-            static_cast<GLsizeiptr>(m_indices.size() * sizeof(unsigned int)),
-            m_indices.data(),
-            GL_STATIC_DRAW);
+    glBindVertexArray(m_vao);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), reinterpret_cast<void*>(positionBase));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(std::uint32_t), reinterpret_cast<void*>(normalBase));
+    glEnableVertexAttribArray(1);
 
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), reinterpret_cast<void*>(0));
-        glEnableVertexAttribArray(0);
+    glBindVertexArray(m_depthVao);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), reinterpret_cast<void*>(positionBase));
+    glEnableVertexAttribArray(0);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Mesh::computeBounds() {
+    m_boundsMin = m_positions.front();
+    m_boundsMax = m_positions.front();
+    for (const glm::vec3& position : m_positions) {
+        m_boundsMin = glm::min(m_boundsMin, position);
+        m_boundsMax = glm::max(m_boundsMax, position);
+    }
+}
 
+void Mesh::bindInstanceAttributes(unsigned int vertexArray, std::size_t byteOffset, bool depthOnly) const {
+    const GLsizei stride = sizeof(MeshInstance);
+    const auto pointer = [&](unsigned int location, int size, std::size_t fieldOffset) {
         glVertexAttribPointer(
-            1,
-            3,
+            location,
+            size,
             GL_FLOAT,
             GL_FALSE,
-            sizeof(MeshVertex),
-            reinterpret_cast<void*>(offsetof(MeshVertex, normal)));
-        glEnableVertexAttribArray(1);
-    }
+            stride,
+            reinterpret_cast<void*>(byteOffset + fieldOffset));
+        glVertexAttribDivisor(location, 1);
+        glEnableVertexAttribArray(location);
+    };
 
+    glBindVertexArray(vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+    for (unsigned int column = 0; column < 4; ++column) {
+        pointer(kInstanceModelLocation + column, 4, offsetof(MeshInstance, model) + column * sizeof(glm::vec4));
+    }
+    if (!depthOnly) {
+        for (unsigned int column = 0; column < 3; ++column) {
+            pointer(
+                kInstanceNormalLocation + column,
+                3,
+                offsetof(MeshInstance, normalMatrix) + column * sizeof(glm::vec3));
+        }
+        glVertexAttribIPointer(
+            kInstanceMaterialLocation,
+            1,
+            GL_UNSIGNED_INT,
+            stride,
+            reinterpret_cast<void*>(byteOffset + offsetof(MeshInstance, materialIndex)));
+        glVertexAttribDivisor(kInstanceMaterialLocation, 1);
+        glEnableVertexAttribArray(kInstanceMaterialLocation);
+    }
     glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
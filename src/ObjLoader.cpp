@@ -8,6 +8,8 @@
 
 #include <glm/glm.hpp>
 
+#include "IndexOptimizer.h"
+
 namespace {
 
 struct ObjIndex {
@@ -139,5 +141,14 @@ ObjMeshData ObjLoader::load(const std::string& path, float scale) {
         throw std::runtime_error("OBJ contains no renderable faces: " + path);
     }
 
+    IndexOptimizer::weldVertices(out.vertices, out.indices);
+    IndexOptimizer::optimizeVertexCache(out.indices, out.vertices.size());
+    std::vector<glm::vec3> weldedPositions;
+    weldedPositions.reserve(out.vertices.size());
+    for (const MeshVertex& vertex : out.vertices) {
+        weldedPositions.push_back(vertex.position);
+    }
+    IndexOptimizer::optimizeOverdraw(out.indices, weldedPositions);
+
     return out;
 }
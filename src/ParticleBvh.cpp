@@ -0,0 +1,236 @@
+#include "ParticleBvh.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+constexpr std::uint32_t kLeafTile = 4;
+constexpr int kMaxStackDepth = 64;
+
+// Slab test of the half-line t >= 0 against an AABB inflated by `pad`; returns the entry t or -1 on a miss.
+float rayBoxEntry(const ParticleRay& ray, const glm::vec3& invDir, const glm::vec3& bmin, const glm::vec3& bmax, float pad) {
+    float tNear = 0.0f;
+    float tFar = std::numeric_limits<float>::infinity();
+    for (int axis = 0; axis < 3; ++axis) {
+        const float lo = bmin[axis] - pad;
+        const float hi = bmax[axis] + pad;
+        if (ray.direction[axis] == 0.0f) {
+            if (ray.origin[axis] < lo || ray.origin[axis] > hi) {
+                return -1.0f;
+            }
+            continue;
+        }
+        float t0 = (lo - ray.origin[axis]) * invDir[axis];
+        float t1 = (hi - ray.origin[axis]) * invDir[axis];
+        if (t0 > t1) {
+            std::swap(t0, t1);
+        }
+        tNear = std::max(tNear, t0);
+        tFar = std::min(tFar, t1);
+        if (tNear > tFar) {
+            return -1.0f;
+        }
+    }
+    return tNear;
+}
+}  // namespace
+
+void ParticleBvh::build(std::size_t rows, std::size_t cols) {
+    m_rows = rows;
+    m_cols = cols;
+    m_nodes.clear();
+    m_leafNodes.clear();
+    m_locked.assign(rows * cols, 0);
+    m_particleLeaf.assign(rows * cols, 0);
+    if (rows == 0 || cols == 0) {
+        return;
+    }
+
+    const std::size_t leafCount = ((rows + kLeafTile - 1) / kLeafTile) * ((cols + kLeafTile - 1) / kLeafTile);
+    m_nodes.reserve(2 * leafCount);
+    m_leafNodes.reserve(leafCount);
+    buildNode(0, static_cast<std::uint32_t>(rows), 0, static_cast<std::uint32_t>(cols));
+}
+
+void ParticleBvh::setLocked(std::size_t index, bool locked) {
+    m_locked[index] = locked ? 1 : 0;
+}
+
+int ParticleBvh::buildNode(std::uint32_t rowBegin, std::uint32_t rowEnd, std::uint32_t colBegin, std::uint32_t colEnd) {
+    const int nodeIndex = static_cast<int>(m_nodes.size());
+    m_nodes.push_back(Node{glm::vec3(0.0f), glm::vec3(0.0f), rowBegin, rowEnd, colBegin, colEnd, -1, -1});
+
+    const std::uint32_t rowSpan = rowEnd - rowBegin;
+    const std::uint32_t colSpan = colEnd - colBegin;
+    if (rowSpan <= kLeafTile && colSpan <= kLeafTile) {
+        m_leafNodes.push_back(static_cast<std::uint32_t>(nodeIndex));
+        for (std::uint32_t r = rowBegin; r < rowEnd; ++r) {
+            for (std::uint32_t c = colBegin; c < colEnd; ++c) {
+                m_particleLeaf[static_cast<std::size_t>(r) * m_cols + c] = static_cast<std::uint32_t>(nodeIndex);
+            }
+        }
+        return nodeIndex;
+    }
+
+    int left = -1;
+    int right = -1;
+    if (rowSpan >= colSpan) {
+        const std::uint32_t split = rowBegin + rowSpan / 2;
+        left = buildNode(rowBegin, split, colBegin, colEnd);
+        right = buildNode(split, rowEnd, colBegin, colEnd);
+    } else {
+        const std::uint32_t split = colBegin + colSpan / 2;
+        left = buildNode(rowBegin, rowEnd, colBegin, split);
+        right = buildNode(rowBegin, rowEnd, split, colEnd);
+    }
+    m_nodes[static_cast<std::size_t>(nodeIndex)].left = left;
+    m_nodes[static_cast<std::size_t>(nodeIndex)].right = right;
+    return nodeIndex;
+}
+
+void ParticleBvh::refit(const std::vector<glm::vec3>& positions) {
+    // Nodes are stored in pre-order, so walking backwards visits children before their parent.
+    for (std::size_t n = m_nodes.size(); n-- > 0;) {
+        Node& node = m_nodes[n];
+        if (node.left >= 0) {
+            const Node& a = m_nodes[static_cast<std::size_t>(node.left)];
+            const Node& b = m_nodes[static_cast<std::size_t>(node.right)];
+            node.boundsMin = glm::min(a.boundsMin, b.boundsMin);
+            node.boundsMax = glm::max(a.boundsMax, b.boundsMax);
+            continue;
+        }
+
+        glm::vec3 bmin(std::numeric_limits<float>::max());
+        glm::vec3 bmax(-std::numeric_limits<float>::max());
+        for (std::uint32_t r = node.rowBegin; r < node.rowEnd; ++r) {
+            const std::size_t rowBase = static_cast<std::size_t>(r) * m_cols;
+            for (std::uint32_t c = node.colBegin; c < node.colEnd; ++c) {
+                const glm::vec3& p = positions[rowBase + c];
+                bmin = glm::min(bmin, p);
+                bmax = glm::max(bmax, p);
+            }
+        }
+        node.boundsMin = bmin;
+        node.boundsMax = bmax;
+    }
+}
+
+void ParticleBvh::clearLeafBounds() {
+    for (const std::uint32_t leaf : m_leafNodes) {
+        m_nodes[leaf].boundsMin = glm::vec3(std::numeric_limits<float>::max());
+        m_nodes[leaf].boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+    }
+}
+
+void ParticleBvh::setLeafBounds(std::uint32_t leaf, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    m_nodes[leaf].boundsMin = boundsMin;
+    m_nodes[leaf].boundsMax = boundsMax;
+}
+
+void ParticleBvh::refitFromLeaves() {
+    for (std::size_t n = m_nodes.size(); n-- > 0;) {
+        Node& node = m_nodes[n];
+        if (node.left < 0) {
+            continue;
+        }
+        const Node& a = m_nodes[static_cast<std::size_t>(node.left)];
+        const Node& b = m_nodes[static_cast<std::size_t>(node.right)];
+        node.boundsMin = glm::min(a.boundsMin, b.boundsMin);
+        node.boundsMax = glm::max(a.boundsMax, b.boundsMax);
+    }
+}
+
+ParticlePickHit ParticleBvh::pick(
+    const ParticleRay& ray,
+    float maxDistance,
+    const std::vector<glm::vec3>& positions) const {
+    ParticlePickHit best;
+    best.distance = maxDistance;
+    if (m_nodes.empty()) {
+        return best;
+    }
+
+    const glm::vec3 invDir(
+        ray.direction.x != 0.0f ? 1.0f / ray.direction.x : 0.0f,
+        ray.direction.y != 0.0f ? 1.0f / ray.direction.y : 0.0f,
+        ray.direction.z != 0.0f ? 1.0f / ray.direction.z : 0.0f);
+
+    int stack[kMaxStackDepth];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const Node& node = m_nodes[static_cast<std::size_t>(stack[--top])];
+        if (rayBoxEntry(ray, invDir, node.boundsMin, node.boundsMax, best.distance) < 0.0f) {
+            continue;
+        }
+
+        if (node.left >= 0) {
+            const Node& a = m_nodes[static_cast<std::size_t>(node.left)];
+            const Node& b = m_nodes[static_cast<std::size_t>(node.right)];
+            const float tA = rayBoxEntry(ray, invDir, a.boundsMin, a.boundsMax, best.distance);
+            const float tB = rayBoxEntry(ray, invDir, b.boundsMin, b.boundsMax, best.distance);
+            // Push the farther child first so the nearer one shrinks the search radius sooner.
+            if (tA >= 0.0f && tB >= 0.0f) {
+                stack[top++] = tA <= tB ? node.right : node.left;
+                stack[top++] = tA <= tB ? node.left : node.right;
+            } else if (tA >= 0.0f) {
+                stack[top++] = node.left;
+            } else if (tB >= 0.0f) {
+                stack[top++] = node.right;
+            }
+            continue;
+        }
+
+        for (std::uint32_t r = node.rowBegin; r < node.rowEnd; ++r) {
+            const std::size_t rowBase = static_cast<std::size_t>(r) * m_cols;
+            for (std::uint32_t c = node.colBegin; c < node.colEnd; ++c) {
+                const std::size_t i = rowBase + c;
+                if (m_locked[i] != 0) {
+                    continue;
+                }
+
+                const glm::vec3 toParticle = positions[i] - ray.origin;
+                const float t = glm::dot(toParticle, ray.direction);
+                if (t < 0.0f) {
+                    continue;
+                }
+
+                const glm::vec3 closest = ray.origin + ray.direction * t;
+                const float dist = glm::length(positions[i] - closest);
+                // Ties resolve to the lowest index, matching a linear scan over the particles.
+                if (dist < best.distance || (best.index >= 0 && dist == best.distance && static_cast<int>(i) < best.index)) {
+                    best.index = static_cast<int>(i);
+                    best.t = t;
+                    best.distance = dist;
+                }
+            }
+        }
+    }
+
+    return best;
+}
+
+std::vector<ParticlePickHit> ParticleBvh::pickBatch(
+    const std::vector<ParticleRay>& rays,
+    float maxDistance,
+    const std::vector<glm::vec3>& positions) const {
+    std::vector<ParticlePickHit> hits;
+    hits.reserve(rays.size());
+    for (const ParticleRay& ray : rays) {
+        hits.push_back(pick(ray, maxDistance, positions));
+    }
+    return hits;
+}
+
+const std::vector<ParticleBvh::Node>& ParticleBvh::nodes() const {
+    return m_nodes;
+}
+
+const std::vector<std::uint32_t>& ParticleBvh::leafNodes() const {
+    return m_leafNodes;
+}
+
+const std::vector<std::uint32_t>& ParticleBvh::particleLeaves() const {
+    return m_particleLeaf;
+}
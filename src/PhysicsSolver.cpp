@@ -1,8 +1,41 @@
 #include "PhysicsSolver.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
 #include <stdexcept>
+#include <utility>
+
+#include "ThreadPool.h"
+
+namespace {
+constexpr float kSelfCollisionThicknessScale = 0.75f;
+constexpr std::size_t kSelfCollisionGrain = 1024;
+constexpr float kColliderThicknessScale = 0.4f;
+constexpr float kColliderFriction = 0.3f;
+constexpr std::size_t kColliderTileGrain = 8;
+
+// Inf and NaN are exactly the floats with every exponent bit set. The integer test stays branch-free and keeps
+// working under -ffinite-math-only, where std::isfinite and x == x may be folded to true.
+inline std::uint32_t nonFiniteBit(float x) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    return static_cast<std::uint32_t>((bits & 0x7f800000u) == 0x7f800000u);
+}
+
+bool finiteMask(const glm::vec3& p) {
+    return (nonFiniteBit(p.x) | nonFiniteBit(p.y) | nonFiniteBit(p.z)) == 0;
+}
+
+bool finiteMask(const glm::vec3& p, const glm::vec3& v) {
+    return (nonFiniteBit(p.x) | nonFiniteBit(p.y) | nonFiniteBit(p.z) | nonFiniteBit(v.x) | nonFiniteBit(v.y) |
+            nonFiniteBit(v.z)) == 0;
+}
+}  // namespace
 
 PhysicsSolver::PhysicsSolver(std::size_t rows, std::size_t cols, float spacing)
     : m_rows(rows),
@@ -16,6 +49,10 @@ PhysicsSolver::PhysicsSolver(std::size_t rows, std::size_t cols, float spacing)
       m_maxStretchRatio(1.08f),
       m_gravity(0.0f, -9.81f, 0.0f),
       m_wind(0.0f, 0.0f, 0.0f),
+      m_selfCollision(false),
+      m_selfCollisionThickness(spacing * kSelfCollisionThicknessScale),
+      m_colliderThickness(spacing * kColliderThicknessScale),
+      m_colliderFriction(kColliderFriction),
       m_draggedIndex(-1),
       m_dragRayT(0.0f),
       m_dragTarget(0.0f) {
@@ -38,19 +75,28 @@ void PhysicsSolver::step(float dt) {
     const float h = clampedDt / static_cast<float>(substeps);
 
     for (int i = 0; i < substeps; ++i) {
-        integrateSubstep(h);
-        satisfyStrainConstraints();
-    }
-
-    for (std::size_t i = 0; i < m_positions.size(); ++i) {
-        const glm::vec3& p = m_positions[i];
-        const glm::vec3& v = m_velocities[i];
-        if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z) || !std::isfinite(v.x) ||
-            !std::isfinite(v.y) || !std::isfinite(v.z)) {
+        // The last substep's passes leave the pick BVH's leaf bounds behind, so no separate refit sweep is needed.
+        const bool boundLeaves = i == substeps - 1;
+        if (!integrateSubstep(h, boundLeaves)) {
+            reset();
+            return;
+        }
+        // Each later pass checks the particles it writes, so a blow-up on the last substep never reaches the mesh.
+        bool finite = satisfyStrainConstraints(boundLeaves);
+        if (m_selfCollision) {
+            finite &= resolveSelfCollisions(boundLeaves);
+        }
+        // Last, so scene contacts win over the strain and self-collision projections.
+        if (m_colliders) {
+            finite &= resolveColliderContacts(boundLeaves);
+        }
+        if (!finite) {
             reset();
             return;
         }
     }
+
+    m_pickBvh.refitFromLeaves();
 }
 
 void PhysicsSolver::reset() {
@@ -66,6 +112,12 @@ void PhysicsSolver::reset() {
     pinConstraints();
 }
 
+void PhysicsSolver::getBounds(glm::vec3& boundsMin, glm::vec3& boundsMax) const {
+    const ParticleBvh::Node& root = m_pickBvh.nodes().front();
+    boundsMin = root.boundsMin;
+    boundsMax = root.boundsMax;
+}
+
 const std::vector<glm::vec3>& PhysicsSolver::getPositions() const {
     return m_positions;
 }
@@ -104,42 +156,34 @@ void PhysicsSolver::setWindStrength(float windStrength) {
     m_wind = glm::vec3(clamped, 0.0f, 0.0f);
 }
 
-bool PhysicsSolver::beginDrag(const glm::vec3& rayOrigin, const glm::vec3& rayDir, float maxDistance) {
-    if (glm::length(rayDir) <= 1e-6f) {
-        return false;
-    }
-
-    int bestIndex = -1;
-    float bestDist = maxDistance;
-    float bestT = 0.0f;
+void PhysicsSolver::setSelfCollisionEnabled(bool enabled) {
+    m_selfCollision = enabled;
+}
 
-    for (std::size_t i = 0; i < m_positions.size(); ++i) {
-        if (m_fixed[i]) {
-            continue;
-        }
+bool PhysicsSolver::isSelfCollisionEnabled() const {
+    return m_selfCollision;
+}
 
-        const glm::vec3 toParticle = m_positions[i] - rayOrigin;
-        const float t = glm::dot(toParticle, rayDir);
-        if (t < 0.0f) {
-            continue;
-        }
+void PhysicsSolver::setColliders(std::shared_ptr<const ColliderSet> colliders) {
+    if (colliders && !colliders->isBuilt()) {
+        throw std::runtime_error("PhysicsSolver::setColliders requires a built ColliderSet");
+    }
+    m_colliders = colliders && !colliders->empty() ? std::move(colliders) : nullptr;
+}
 
-        const glm::vec3 closest = rayOrigin + rayDir * t;
-        const float dist = glm::length(m_positions[i] - closest);
-        if (dist < bestDist) {
-            bestDist = dist;
-            bestIndex = static_cast<int>(i);
-            bestT = t;
-        }
+bool PhysicsSolver::beginDrag(const glm::vec3& rayOrigin, const glm::vec3& rayDir, float maxDistance) {
+    if (glm::length(rayDir) <= 1e-6f) {
+        return false;
     }
 
-    if (bestIndex < 0) {
+    const ParticlePickHit hit = m_pickBvh.pick(ParticleRay{rayOrigin, rayDir}, maxDistance, m_positions);
+    if (hit.index < 0) {
         return false;
     }
 
-    m_draggedIndex = bestIndex;
-    m_dragRayT = bestT;
-    m_dragTarget = rayOrigin + rayDir * bestT;
+    m_draggedIndex = hit.index;
+    m_dragRayT = hit.t;
+    m_dragTarget = rayOrigin + rayDir * hit.t;
     return true;
 }
 
@@ -165,6 +209,10 @@ bool PhysicsSolver::isDragging() const {
     return m_draggedIndex >= 0;
 }
 
+std::vector<ParticlePickHit> PhysicsSolver::pickParticles(const std::vector<ParticleRay>& rays, float maxDistance) const {
+    return m_pickBvh.pickBatch(rays, maxDistance, m_positions);
+}
+
 std::size_t PhysicsSolver::index(std::size_t row, std::size_t col) const {
     return row * m_cols + col;
 }
@@ -191,6 +239,9 @@ void PhysicsSolver::initializeGrid() {
             m_positions[index(r, c)] = glm::vec3(x, 2.35f, z);
         }
     }
+
+    m_pickBvh.build(m_rows, m_cols);
+    m_pickBvh.refit(m_positions);
 }
 
 void PhysicsSolver::initializeSprings() {
@@ -225,9 +276,11 @@ void PhysicsSolver::initializeSprings() {
 void PhysicsSolver::pinConstraints() {
     m_fixed[index(0, 0)] = true;
     m_fixed[index(0, m_cols - 1)] = true;
+    m_pickBvh.setLocked(index(0, 0), true);
+    m_pickBvh.setLocked(index(0, m_cols - 1), true);
 }
 
-void PhysicsSolver::integrateSubstep(float dt) {
+bool PhysicsSolver::integrateSubstep(float dt, bool boundLeaves) {
     std::vector<glm::vec3> forces(m_positions.size(), m_gravity * m_mass);
 
     for (const Spring& spring : m_springs) {
@@ -247,37 +300,115 @@ void PhysicsSolver::integrateSubstep(float dt) {
         forces[spring.b] -= springForce;
     }
 
+    // Grown leaf bounds are a superset when a later pass moves a particle; those passes grow them again.
+    const std::vector<std::uint32_t>& leaves = m_pickBvh.particleLeaves();
+    if (boundLeaves) {
+        m_pickBvh.clearLeafBounds();
+    }
+
+    bool finite = true;
     for (std::size_t i = 0; i < m_positions.size(); ++i) {
         if (m_fixed[i]) {
             m_velocities[i] = glm::vec3(0.0f);
-            continue;
-        }
-        if (static_cast<int>(i) == m_draggedIndex) {
+        } else if (static_cast<int>(i) == m_draggedIndex) {
             m_positions[i] = m_dragTarget;
             m_velocities[i] = glm::vec3(0.0f);
-            continue;
-        }
+        } else {
+            forces[i] += m_wind;
+            forces[i] += -m_damping * m_velocities[i];
+
+            const glm::vec3 acceleration = forces[i] / m_mass;
+            m_velocities[i] += acceleration * dt;
+            const float speed = glm::length(m_velocities[i]);
+            if (speed > m_maxSpeed) {
+                m_velocities[i] *= m_maxSpeed / speed;
+            }
 
-        forces[i] += m_wind;
-        forces[i] += -m_damping * m_velocities[i];
+            m_positions[i] += m_velocities[i] * dt;
 
-        const glm::vec3 acceleration = forces[i] / m_mass;
-        m_velocities[i] += acceleration * dt;
-        const float speed = glm::length(m_velocities[i]);
-        if (speed > m_maxSpeed) {
-            m_velocities[i] *= m_maxSpeed / speed;
+            if (m_positions[i].y < -1.2f) {
+                m_positions[i].y = -1.2f;
+                m_velocities[i].y *= -0.15f;
+            }
+
+            finite &= finiteMask(m_positions[i], m_velocities[i]);
+        }
+        if (boundLeaves) {
+            m_pickBvh.growLeaf(leaves[i], m_positions[i]);
         }
+    }
 
-        m_positions[i] += m_velocities[i] * dt;
+    return finite;
+}
 
-        if (m_positions[i].y < -1.2f) {
-            m_positions[i].y = -1.2f;
-            m_velocities[i].y *= -0.15f;
-        }
+bool PhysicsSolver::resolveColliderContacts(bool boundLeaves) {
+    const ColliderSet& colliders = *m_colliders;
+    const std::vector<ParticleBvh::Node>& nodes = m_pickBvh.nodes();
+    const std::vector<std::uint32_t>& leafTiles = m_pickBvh.leafNodes();
+    const float thickness = m_colliderThickness;
+    std::atomic<bool> finite(true);
+    // The set is shared and may have been edited since setColliders; queries must not throw on the pool's workers.
+    if (!colliders.isBuilt()) {
+        throw std::runtime_error("PhysicsSolver colliders were modified without calling ColliderSet::build");
     }
+
+    // Broadphase per BVH leaf tile: one collider query covers up to 16 particles. Tiles own disjoint particles, so
+    // each tile's final bounds can be written to its leaf without contention.
+    ThreadPool::shared().parallelFor(0, leafTiles.size(), kColliderTileGrain, [&](std::size_t begin, std::size_t end) {
+        std::vector<std::uint32_t> candidates;
+        bool chunkFinite = true;
+        for (std::size_t t = begin; t < end; ++t) {
+            const std::uint32_t leaf = leafTiles[t];
+            const ParticleBvh::Node& tile = nodes[leaf];
+            glm::vec3 bmin(std::numeric_limits<float>::max());
+            glm::vec3 bmax(-std::numeric_limits<float>::max());
+            for (std::uint32_t r = tile.rowBegin; r < tile.rowEnd; ++r) {
+                for (std::uint32_t c = tile.colBegin; c < tile.colEnd; ++c) {
+                    const glm::vec3& p = m_positions[index(r, c)];
+                    bmin = glm::min(bmin, p);
+                    bmax = glm::max(bmax, p);
+                }
+            }
+
+            candidates.clear();
+            colliders.queryOverlaps(bmin - glm::vec3(thickness), bmax + glm::vec3(thickness), candidates);
+            if (candidates.empty()) {
+                if (boundLeaves) {
+                    m_pickBvh.setLeafBounds(leaf, bmin, bmax);
+                }
+                continue;
+            }
+
+            glm::vec3 resolvedMin(std::numeric_limits<float>::max());
+            glm::vec3 resolvedMax(-std::numeric_limits<float>::max());
+            for (std::uint32_t r = tile.rowBegin; r < tile.rowEnd; ++r) {
+                for (std::uint32_t c = tile.colBegin; c < tile.colEnd; ++c) {
+                    const std::size_t i = index(r, c);
+                    if (!m_fixed[i] && static_cast<int>(i) != m_draggedIndex) {
+                        for (const std::uint32_t collider : candidates) {
+                            colliders.resolveParticle(
+                                collider, m_positions[i], m_velocities[i], thickness, m_colliderFriction);
+                        }
+                        chunkFinite &= finiteMask(m_positions[i], m_velocities[i]);
+                    }
+                    resolvedMin = glm::min(resolvedMin, m_positions[i]);
+                    resolvedMax = glm::max(resolvedMax, m_positions[i]);
+                }
+            }
+            if (boundLeaves) {
+                m_pickBvh.setLeafBounds(leaf, resolvedMin, resolvedMax);
+            }
+        }
+        if (!chunkFinite) {
+            finite.store(false, std::memory_order_relaxed);
+        }
+    });
+    return finite.load(std::memory_order_relaxed);
 }
 
-void PhysicsSolver::satisfyStrainConstraints() {
+bool PhysicsSolver::satisfyStrainConstraints(bool boundLeaves) {
+    const std::vector<std::uint32_t>& leaves = m_pickBvh.particleLeaves();
+    bool finite = true;
     for (const Spring& spring : m_springs) {
         const glm::vec3 delta = m_positions[spring.a] - m_positions[spring.b];
         const float length = glm::length(delta);
@@ -309,10 +440,94 @@ void PhysicsSolver::satisfyStrainConstraints() {
         } else if (lockA && !lockB) {
             m_positions[spring.b] += correction;
         }
+        finite &= finiteMask(m_positions[spring.a]) && finiteMask(m_positions[spring.b]);
+        if (boundLeaves) {
+            m_pickBvh.growLeaf(leaves[spring.a], m_positions[spring.a]);
+            m_pickBvh.growLeaf(leaves[spring.b], m_positions[spring.b]);
+        }
     }
 
     if (m_draggedIndex >= 0) {
-        m_positions[static_cast<std::size_t>(m_draggedIndex)] = m_dragTarget;
-        m_velocities[static_cast<std::size_t>(m_draggedIndex)] = glm::vec3(0.0f);
+        const std::size_t dragged = static_cast<std::size_t>(m_draggedIndex);
+        m_positions[dragged] = m_dragTarget;
+        m_velocities[dragged] = glm::vec3(0.0f);
+        if (boundLeaves) {
+            m_pickBvh.growLeaf(leaves[dragged], m_dragTarget);
+        }
+    }
+    return finite;
+}
+
+bool PhysicsSolver::resolveSelfCollisions(bool boundLeaves) {
+    const float thickness = m_selfCollisionThickness;
+    m_selfCollisionHash.build(m_positions, thickness);
+    m_collisionDelta.resize(m_positions.size());
+
+    const std::vector<std::uint32_t>& sorted = m_selfCollisionHash.sortedParticles();
+    const long cols = static_cast<long>(m_cols);
+    const auto isStencilNeighbour = [cols](std::size_t a, std::size_t b) {
+        const long ra = static_cast<long>(a) / cols;
+        const long rb = static_cast<long>(b) / cols;
+        const long ca = static_cast<long>(a) - ra * cols;
+        const long cb = static_cast<long>(b) - rb * cols;
+        return std::labs(ra - rb) <= 2 && std::labs(ca - cb) <= 2;
+    };
+    const auto locked = [this](std::size_t i) {
+        return m_fixed[i] || static_cast<int>(i) == m_draggedIndex;
+    };
+
+    // Jacobi pass: each particle only accumulates its own correction, so the loop is race-free across threads.
+    ThreadPool::shared().parallelFor(0, m_positions.size(), kSelfCollisionGrain, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            glm::vec3 delta(0.0f);
+            if (locked(i)) {
+                m_collisionDelta[i] = delta;
+                continue;
+            }
+
+            const glm::vec3 p = m_positions[i];
+            const glm::ivec3 baseCell = m_selfCollisionHash.cellOf(p);
+            for (int dz = -1; dz <= 1; ++dz) {
+                for (int dy = -1; dy <= 1; ++dy) {
+                    for (int dx = -1; dx <= 1; ++dx) {
+                        const glm::ivec3 cell = baseCell + glm::ivec3(dx, dy, dz);
+                        const std::uint32_t bucket = m_selfCollisionHash.bucketOf(cell);
+                        const std::uint32_t bucketEnd = m_selfCollisionHash.bucketEnd(bucket);
+                        for (std::uint32_t s = m_selfCollisionHash.bucketBegin(bucket); s < bucketEnd; ++s) {
+                            const std::size_t j = sorted[s];
+                            if (j == i || m_selfCollisionHash.particleCell(j) != cell) {
+                                continue;
+                            }
+
+                            const glm::vec3 d = p - m_positions[j];
+                            const float distSq = glm::dot(d, d);
+                            if (distSq >= thickness * thickness || distSq <= 1e-12f) {
+                                continue;
+                            }
+                            // Stencil neighbours are already kept apart by their springs.
+                            if (isStencilNeighbour(i, j)) {
+                                continue;
+                            }
+
+                            const float dist = std::sqrt(distSq);
+                            const glm::vec3 correction = (thickness - dist) * (d / dist);
+                            delta += locked(j) ? correction : 0.5f * correction;
+                        }
+                    }
+                }
+            }
+            m_collisionDelta[i] = delta;
+        }
+    });
+
+    const std::vector<std::uint32_t>& leaves = m_pickBvh.particleLeaves();
+    bool finite = true;
+    for (std::size_t i = 0; i < m_positions.size(); ++i) {
+        m_positions[i] += m_collisionDelta[i];
+        finite &= finiteMask(m_positions[i]);
+        if (boundLeaves) {
+            m_pickBvh.growLeaf(leaves[i], m_positions[i]);
+        }
     }
+    return finite;
 }
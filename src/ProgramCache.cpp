@@ -0,0 +1,292 @@
+#include "ProgramCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <GL/glew.h>
+
+#include "Hash.h"
+
+namespace {
+constexpr char kFileMagic[4] = {'C', 'P', 'R', 'G'};
+constexpr std::uint32_t kFileVersion = 1;
+
+struct ProgramFileHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint64_t key;
+    std::uint32_t format;
+    std::uint32_t length;
+};
+static_assert(sizeof(ProgramFileHeader) == 24, "ProgramFileHeader must stay tightly packed");
+
+std::string& cacheDirectory() {
+    static std::string directory;
+    return directory;
+}
+
+bool binariesSupported() {
+    if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary) {
+        return false;
+    }
+    int formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+std::uint64_t hashString(const char* text, std::uint64_t seed) {
+    const char* value = text != nullptr ? text : "";
+    // Hash the terminator too, so adjacent strings cannot run together.
+    return fnv1a64(value, std::strlen(value) + 1, seed);
+}
+
+std::uint64_t programKey(const std::vector<ProgramCache::Stage>& stages) {
+    std::uint64_t hash = fnv1a64(&kFileVersion, sizeof(kFileVersion));
+    hash = hashString(reinterpret_cast<const char*>(glGetString(GL_VENDOR)), hash);
+    hash = hashString(reinterpret_cast<const char*>(glGetString(GL_RENDERER)), hash);
+    hash = hashString(reinterpret_cast<const char*>(glGetString(GL_VERSION)), hash);
+    for (const ProgramCache::Stage& stage : stages) {
+        hash = fnv1a64(&stage.type, sizeof(stage.type), hash);
+        hash = hashString(stage.source.c_str(), hash);
+    }
+    return hash;
+}
+
+std::string readTextFile(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file: " + path);
+    }
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+std::string programLog(unsigned int program) {
+    int logLength = 0;
+    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
+    std::string log(static_cast<std::size_t>(std::max(1, logLength)), '\0');
+    glGetProgramInfoLog(program, logLength, nullptr, log.data());
+    return log;
+}
+} // namespace
+
+void ProgramCache::setDirectory(const std::string& directory) {
+    cacheDirectory() = directory;
+}
+
+const std::string& ProgramCache::directory() {
+    return cacheDirectory();
+}
+
+// Expands `#include "file"` lines (relative to the including file) so kernels can share declarations.
+// Each file is pasted at most once per program; #line directives keep compiler errors on the right line.
+std::string ProgramCache::loadSource(const std::string& path) {
+    std::vector<std::string> included;
+    const auto expand = [&included](const auto& self, const std::string& filePath) -> std::string {
+        if (std::find(included.begin(), included.end(), filePath) != included.end()) {
+            return std::string();
+        }
+        included.push_back(filePath);
+
+        const std::size_t slash = filePath.find_last_of('/');
+        const std::string directory = slash == std::string::npos ? std::string() : filePath.substr(0, slash + 1);
+
+        std::istringstream input(readTextFile(filePath));
+        std::ostringstream output;
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(input, line)) {
+            ++lineNumber;
+            const std::size_t directive = line.find_first_not_of(" \t");
+            if (directive == std::string::npos || line.compare(directive, 8, "#include") != 0) {
+                output << line << '\n';
+                continue;
+            }
+            const std::size_t open = line.find('"', directive);
+            const std::size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+            if (close == std::string::npos) {
+                throw std::runtime_error("Malformed #include in " + filePath + ":" + std::to_string(lineNumber));
+            }
+            output << "#line 1\n";
+            output << self(self, directory + line.substr(open + 1, close - open - 1));
+            output << "#line " << lineNumber + 1 << '\n';
+        }
+        return output.str();
+    };
+    return expand(expand, path);
+}
+
+// Adds `#define` lines right after the #version directive.
+std::string ProgramCache::insertDefines(const std::string& source, const std::vector<std::string>& defines) {
+    if (defines.empty()) {
+        return source;
+    }
+    const std::size_t versionEnd = source.find('\n', source.find("#version"));
+    if (versionEnd == std::string::npos) {
+        throw std::runtime_error("Shader source has no #version line");
+    }
+
+    std::string block;
+    for (const std::string& define : defines) {
+        block += "#define " + define + "\n";
+    }
+    // Restore the numbering so compiler errors still point at the file's own lines.
+    block += "#line 2\n";
+    return source.substr(0, versionEnd + 1) + block + source.substr(versionEnd + 1);
+}
+
+unsigned int ProgramCache::build(const std::vector<Stage>& stages) {
+    const bool cached = !cacheDirectory().empty() && binariesSupported();
+    std::uint64_t key = 0;
+    std::string path;
+    if (cached) {
+        key = programKey(stages);
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+        path = (std::filesystem::path(cacheDirectory()) / name).string();
+
+        const unsigned int program = loadBinary(path, key);
+        if (program != 0) {
+            return program;
+        }
+    }
+
+    std::vector<unsigned int> shaders;
+    const unsigned int program = glCreateProgram();
+    try {
+        for (const Stage& stage : stages) {
+            shaders.push_back(compileStage(stage));
+            glAttachShader(program, shaders.back());
+        }
+    } catch (const std::runtime_error&) {
+        for (const unsigned int shader : shaders) {
+            glDeleteShader(shader);
+        }
+        glDeleteProgram(program);
+        throw;
+    }
+    if (cached) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(program);
+    for (const unsigned int shader : shaders) {
+        glDetachShader(program, shader);
+        glDeleteShader(shader);
+    }
+
+    int success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (success == GL_FALSE) {
+        const std::string log = programLog(program);
+        glDeleteProgram(program);
+        throw std::runtime_error("Shader link failed: " + log);
+    }
+
+    if (cached) {
+        try {
+            saveBinary(path, key, program);
+        } catch (const std::runtime_error&) {
+            // The cache is only an accelerator; a read-only tree still gets a freshly linked program.
+        }
+    }
+    return program;
+}
+
+unsigned int ProgramCache::loadBinary(const std::string& path, std::uint64_t key) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return 0;
+    }
+
+    ProgramFileHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || std::memcmp(header.magic, kFileMagic, sizeof(kFileMagic)) != 0 || header.version != kFileVersion ||
+        header.key != key || header.length == 0) {
+        return 0;
+    }
+    std::vector<char> binary(header.length);
+    file.read(binary.data(), static_cast<std::streamsize>(binary.size()));
+    if (!file) {
+        return 0;
+    }
+
+    // Drivers reject binaries from other builds with a failed link status rather than an error.
+    const unsigned int program = glCreateProgram();
+    glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+    int success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (success == GL_FALSE) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+void ProgramCache::saveBinary(const std::string& path, std::uint64_t key, unsigned int program) {
+    int length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+    std::vector<char> binary(static_cast<std::size_t>(length));
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+
+    ProgramFileHeader header{};
+    std::memcpy(header.magic, kFileMagic, sizeof(kFileMagic));
+    header.version = kFileVersion;
+    header.key = key;
+    header.format = format;
+    header.length = static_cast<std::uint32_t>(length);
+
+    const std::filesystem::path target(path);
+    std::error_code ec;
+    if (target.has_parent_path()) {
+        std::filesystem::create_directories(target.parent_path(), ec);
+    }
+
+    // Write beside the target and rename, so a concurrent launch never reads a half-written binary.
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("Unable to write program cache: " + temporary);
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), length);
+        if (!file) {
+            throw std::runtime_error("Unable to write program cache: " + temporary);
+        }
+    }
+    std::filesystem::rename(temporary, target, ec);
+    if (ec) {
+        std::filesystem::remove(temporary, ec);
+        throw std::runtime_error("Unable to move program cache into place: " + path);
+    }
+}
+
+unsigned int ProgramCache::compileStage(const Stage& stage) {
+    const unsigned int shader = glCreateShader(stage.type);
+    const char* ptr = stage.source.c_str();
+    glShaderSource(shader, 1, &ptr, nullptr);
+    glCompileShader(shader);
+
+    int success = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (success == GL_FALSE) {
+        int logLength = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
+        std::string log(static_cast<std::size_t>(std::max(1, logLength)), '\0');
+        glGetShaderInfoLog(shader, logLength, nullptr, log.data());
+        glDeleteShader(shader);
+        throw std::runtime_error("Shader compile failed: " + log);
+    }
+    return shader;
+}
@@ -0,0 +1,69 @@
+#include "RenderUniforms.h"
+
+#include <stdexcept>
+
+#include <GL/glew.h>
+
+RenderUniforms::RenderUniforms() : m_materialsDirty(true), m_frameUbo(0), m_materialUbo(0) {
+    glGenBuffers(1, &m_frameUbo);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_frameUbo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniformData), nullptr, GL_DYNAMIC_DRAW);
+
+    // Sized for the whole block: std140 arrays are read at their declared length.
+    glGenBuffers(1, &m_materialUbo);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_materialUbo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(MaterialData) * kMaxMaterials, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+RenderUniforms::~RenderUniforms() {
+    if (m_materialUbo != 0) {
+        glDeleteBuffers(1, &m_materialUbo);
+    }
+    if (m_frameUbo != 0) {
+        glDeleteBuffers(1, &m_frameUbo);
+    }
+}
+
+std::uint32_t RenderUniforms::addMaterial(const glm::vec3& baseColor, float specularStrength, float shininess) {
+    const MaterialData material{glm::vec4(baseColor, specularStrength), glm::vec4(shininess, 0.0f, 0.0f, 0.0f)};
+    for (std::size_t i = 0; i < m_materials.size(); ++i) {
+        if (m_materials[i].baseColorSpecular == material.baseColorSpecular &&
+            m_materials[i].shininess == material.shininess) {
+            return static_cast<std::uint32_t>(i);
+        }
+    }
+    if (m_materials.size() == kMaxMaterials) {
+        throw std::runtime_error("RenderUniforms material table is full");
+    }
+    m_materials.push_back(material);
+    m_materialsDirty = true;
+    return static_cast<std::uint32_t>(m_materials.size() - 1);
+}
+
+void RenderUniforms::attach(const Shader& shader) const {
+    shader.bindUniformBlock("FrameUniforms", kFrameBinding);
+    shader.bindUniformBlock("MaterialUniforms", kMaterialBinding);
+}
+
+void RenderUniforms::update(const FrameUniformData& frame) {
+    glBindBuffer(GL_UNIFORM_BUFFER, m_frameUbo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniformData), &frame);
+    if (m_materialsDirty && !m_materials.empty()) {
+        glBindBuffer(GL_UNIFORM_BUFFER, m_materialUbo);
+        glBufferSubData(
+            GL_UNIFORM_BUFFER,
+            0,
+            static_cast<GLsizeiptr>(m_materials.size() * sizeof(MaterialData)),
+            m_materials.data());
+        m_materialsDirty = false;
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, kFrameBinding, m_frameUbo);
+    glBindBufferBase(GL_UNIFORM_BUFFER, kMaterialBinding, m_materialUbo);
+}
+
+std::size_t RenderUniforms::materialCount() const {
+    return m_materials.size();
+}
@@ -0,0 +1,184 @@
+#include "SceneBvh.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+constexpr std::uint32_t kLeafItems = 4;
+constexpr int kMaxStackDepth = 64;
+constexpr std::uint32_t kAllPlanes = 0x3f;
+
+enum class PlaneSide { Outside, Straddling, Inside };
+
+PlaneSide classify(const glm::vec4& plane, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    const glm::vec3 normal(plane);
+    // Corners farthest along and against the plane normal.
+    const glm::vec3 positive(
+        normal.x >= 0.0f ? boundsMax.x : boundsMin.x,
+        normal.y >= 0.0f ? boundsMax.y : boundsMin.y,
+        normal.z >= 0.0f ? boundsMax.z : boundsMin.z);
+    const glm::vec3 negative(
+        normal.x >= 0.0f ? boundsMin.x : boundsMax.x,
+        normal.y >= 0.0f ? boundsMin.y : boundsMax.y,
+        normal.z >= 0.0f ? boundsMin.z : boundsMax.z);
+    if (glm::dot(normal, positive) + plane.w < 0.0f) {
+        return PlaneSide::Outside;
+    }
+    return glm::dot(normal, negative) + plane.w >= 0.0f ? PlaneSide::Inside : PlaneSide::Straddling;
+}
+}  // namespace
+
+Frustum Frustum::fromMatrix(const glm::mat4& viewProjection) {
+    const auto row = [&](int r) {
+        return glm::vec4(viewProjection[0][r], viewProjection[1][r], viewProjection[2][r], viewProjection[3][r]);
+    };
+    Frustum frustum;
+    frustum.planes[0] = row(3) + row(0);
+    frustum.planes[1] = row(3) - row(0);
+    frustum.planes[2] = row(3) + row(1);
+    frustum.planes[3] = row(3) - row(1);
+    frustum.planes[4] = row(3) + row(2);
+    frustum.planes[5] = row(3) - row(2);
+    return frustum;
+}
+
+bool Frustum::intersects(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const {
+    for (const glm::vec4& plane : planes) {
+        if (classify(plane, boundsMin, boundsMax) == PlaneSide::Outside) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SceneBvh::build(const std::vector<glm::vec3>& boundsMin, const std::vector<glm::vec3>& boundsMax) {
+    if (boundsMin.size() != boundsMax.size()) {
+        throw std::runtime_error("SceneBvh bounds size mismatch");
+    }
+    m_itemMin = boundsMin;
+    m_itemMax = boundsMax;
+    m_items.resize(boundsMin.size());
+    for (std::size_t i = 0; i < m_items.size(); ++i) {
+        m_items[i] = static_cast<std::uint32_t>(i);
+    }
+    m_nodes.clear();
+    if (m_items.empty()) {
+        return;
+    }
+    m_nodes.reserve(2 * (m_items.size() / kLeafItems + 1));
+    buildNode(0, static_cast<std::uint32_t>(m_items.size()));
+}
+
+int SceneBvh::buildNode(std::uint32_t begin, std::uint32_t end) {
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(-std::numeric_limits<float>::max());
+    glm::vec3 centroidMin(std::numeric_limits<float>::max());
+    glm::vec3 centroidMax(-std::numeric_limits<float>::max());
+    for (std::uint32_t i = begin; i < end; ++i) {
+        const std::uint32_t item = m_items[i];
+        boundsMin = glm::min(boundsMin, m_itemMin[item]);
+        boundsMax = glm::max(boundsMax, m_itemMax[item]);
+        const glm::vec3 centroid = 0.5f * (m_itemMin[item] + m_itemMax[item]);
+        centroidMin = glm::min(centroidMin, centroid);
+        centroidMax = glm::max(centroidMax, centroid);
+    }
+
+    const int nodeIndex = static_cast<int>(m_nodes.size());
+    m_nodes.push_back(Node{boundsMin, boundsMax, begin, end, -1, -1});
+    if (end - begin <= kLeafItems) {
+        return nodeIndex;
+    }
+
+    const glm::vec3 extent = centroidMax - centroidMin;
+    int axis = 0;
+    if (extent.y > extent[axis]) {
+        axis = 1;
+    }
+    if (extent.z > extent[axis]) {
+        axis = 2;
+    }
+    const std::uint32_t split = begin + (end - begin) / 2;
+    std::nth_element(
+        m_items.begin() + begin,
+        m_items.begin() + split,
+        m_items.begin() + end,
+        [&](std::uint32_t a, std::uint32_t b) {
+            return m_itemMin[a][axis] + m_itemMax[a][axis] < m_itemMin[b][axis] + m_itemMax[b][axis];
+        });
+
+    // Depth stays logarithmic in the item count: the median split halves every range.
+    const int left = buildNode(begin, split);
+    const int right = buildNode(split, end);
+    m_nodes[static_cast<std::size_t>(nodeIndex)].left = left;
+    m_nodes[static_cast<std::size_t>(nodeIndex)].right = right;
+    return nodeIndex;
+}
+
+std::size_t SceneBvh::cull(const Frustum& frustum, std::vector<std::uint32_t>& visible) const {
+    if (m_nodes.empty()) {
+        return 0;
+    }
+
+    // Each entry carries the planes its parent still straddled.
+    int stack[kMaxStackDepth];
+    std::uint32_t stackPlanes[kMaxStackDepth];
+    int stackSize = 0;
+    stack[stackSize] = 0;
+    stackPlanes[stackSize++] = kAllPlanes;
+    std::size_t tested = 0;
+
+    while (stackSize > 0) {
+        --stackSize;
+        const Node& node = m_nodes[static_cast<std::size_t>(stack[stackSize])];
+        std::uint32_t planes = stackPlanes[stackSize];
+        ++tested;
+
+        bool outside = false;
+        for (int p = 0; p < 6 && !outside; ++p) {
+            if ((planes & (1u << p)) == 0) {
+                continue;
+            }
+            const PlaneSide side = classify(frustum.planes[p], node.boundsMin, node.boundsMax);
+            outside = side == PlaneSide::Outside;
+            if (side == PlaneSide::Inside) {
+                planes &= ~(1u << p);
+            }
+        }
+        if (outside) {
+            continue;
+        }
+
+        if (planes == 0) {
+            visible.insert(visible.end(), m_items.begin() + node.itemBegin, m_items.begin() + node.itemEnd);
+            continue;
+        }
+        if (node.left < 0) {
+            for (std::uint32_t i = node.itemBegin; i < node.itemEnd; ++i) {
+                const std::uint32_t item = m_items[i];
+                if (frustum.intersects(m_itemMin[item], m_itemMax[item])) {
+                    visible.push_back(item);
+                }
+            }
+            continue;
+        }
+        if (stackSize + 2 > kMaxStackDepth) {
+            // Unreachable for median-split trees; keep the subtree rather than risk dropping visible items.
+            visible.insert(visible.end(), m_items.begin() + node.itemBegin, m_items.begin() + node.itemEnd);
+            continue;
+        }
+        stack[stackSize] = node.right;
+        stackPlanes[stackSize++] = planes;
+        stack[stackSize] = node.left;
+        stackPlanes[stackSize++] = planes;
+    }
+    return tested;
+}
+
+std::size_t SceneBvh::itemCount() const {
+    return m_items.size();
+}
+
+const std::vector<SceneBvh::Node>& SceneBvh::nodes() const {
+    return m_nodes;
+}
@@ -0,0 +1,134 @@
+#include "SceneInstances.h"
+
+#include <algorithm>
+
+#include <GL/glew.h>
+
+SceneInstances::SceneInstances() : m_instanceVbo(0) {}
+
+SceneInstances::~SceneInstances() {
+    if (m_instanceVbo != 0) {
+        glDeleteBuffers(1, &m_instanceVbo);
+    }
+}
+
+void SceneInstances::add(const std::shared_ptr<Mesh>& mesh, const glm::mat4& model, std::uint32_t materialIndex) {
+    std::size_t batchIndex = 0;
+    while (batchIndex < m_batches.size() && m_batches[batchIndex].mesh != mesh) {
+        ++batchIndex;
+    }
+    if (batchIndex == m_batches.size()) {
+        m_batches.emplace_back();
+        m_batches.back().mesh = mesh;
+    }
+    Batch& batch = m_batches[batchIndex];
+    m_refs.push_back({static_cast<std::uint32_t>(batchIndex), static_cast<std::uint32_t>(batch.instances.size())});
+    batch.instances.push_back(Mesh::makeInstance(model, materialIndex));
+
+    // World bounds of the transformed object-space box.
+    const glm::vec3& localMin = mesh->boundsMin();
+    const glm::vec3& localMax = mesh->boundsMax();
+    glm::vec3 worldMin(0.0f);
+    glm::vec3 worldMax(0.0f);
+    for (int corner = 0; corner < 8; ++corner) {
+        const glm::vec3 local(
+            (corner & 1) != 0 ? localMax.x : localMin.x,
+            (corner & 2) != 0 ? localMax.y : localMin.y,
+            (corner & 4) != 0 ? localMax.z : localMin.z);
+        const glm::vec3 world(model * glm::vec4(local, 1.0f));
+        worldMin = corner == 0 ? world : glm::min(worldMin, world);
+        worldMax = corner == 0 ? world : glm::max(worldMax, world);
+    }
+    m_boundsMin.push_back(worldMin);
+    m_boundsMax.push_back(worldMax);
+}
+
+void SceneInstances::upload() {
+    m_bvh.build(m_boundsMin, m_boundsMax);
+
+    const std::size_t total = instanceCount();
+    if (m_instanceVbo == 0) {
+        glGenBuffers(1, &m_instanceVbo);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceVbo);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(2 * total * sizeof(MeshInstance)), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    std::size_t first = 0;
+    for (Batch& batch : m_batches) {
+        batch.first = first;
+        batch.visible[0] = 0;
+        batch.visible[1] = 0;
+        batch.mesh->setInstanceStream(
+            m_instanceVbo,
+            first * sizeof(MeshInstance),
+            (total + first) * sizeof(MeshInstance));
+        first += batch.instances.size();
+    }
+    m_staging.resize(total);
+}
+
+void SceneInstances::cull(ScenePass pass, const glm::mat4& viewProjection) {
+    const int passIndex = static_cast<int>(pass);
+    SceneCullStats& stats = m_stats[passIndex];
+    m_visible.clear();
+    stats.nodesTested = m_bvh.cull(Frustum::fromMatrix(viewProjection), m_visible);
+    stats.visible = m_visible.size();
+    stats.culled = m_refs.size() - m_visible.size();
+
+    for (Batch& batch : m_batches) {
+        batch.visible[passIndex] = 0;
+    }
+    std::size_t uploadCount = 0;
+    for (const std::uint32_t item : m_visible) {
+        const InstanceRef& ref = m_refs[item];
+        Batch& batch = m_batches[ref.batch];
+        const std::size_t slot = batch.first + batch.visible[passIndex]++;
+        m_staging[slot] = batch.instances[ref.instance];
+        uploadCount = std::max(uploadCount, slot + 1);
+    }
+    if (uploadCount == 0) {
+        return;
+    }
+
+    // Slices keep fixed offsets, so the stale tail of each slice goes up with the survivors: one upload per
+    // pass, and the meshes' VAOs never change.
+    const std::size_t base = pass == ScenePass::Main ? 0 : m_staging.size();
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceVbo);
+    glBufferSubData(
+        GL_ARRAY_BUFFER,
+        static_cast<GLintptr>(base * sizeof(MeshInstance)),
+        static_cast<GLsizeiptr>(uploadCount * sizeof(MeshInstance)),
+        m_staging.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void SceneInstances::draw() const {
+    const int passIndex = static_cast<int>(ScenePass::Main);
+    for (const Batch& batch : m_batches) {
+        if (batch.visible[passIndex] > 0) {
+            batch.mesh->drawInstanced(batch.visible[passIndex]);
+        }
+    }
+}
+
+void SceneInstances::drawDepth() const {
+    const int passIndex = static_cast<int>(ScenePass::Depth);
+    for (const Batch& batch : m_batches) {
+        if (batch.visible[passIndex] > 0) {
+            batch.mesh->drawDepthInstanced(batch.visible[passIndex]);
+        }
+    }
+}
+
+std::size_t SceneInstances::instanceCount() const {
+    return m_refs.size();
+}
+
+std::size_t SceneInstances::batchCount() const {
+    return m_batches.size();
+}
+
+const SceneCullStats& SceneInstances::cullStats(ScenePass pass) const {
+    return m_stats[static_cast<int>(pass)];
+}
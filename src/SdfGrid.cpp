@@ -0,0 +1,552 @@
+#include "SdfGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Geometry.h"
+#include "Hash.h"
+#include "ThreadPool.h"
+
+namespace {
+constexpr char kFileMagic[4] = {'C', 'S', 'D', 'F'};
+constexpr std::uint32_t kFileVersion = 1;
+
+struct SdfFileHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint64_t key;
+    float origin[3];
+    float voxelSize;
+    float bandWidth;
+    std::uint32_t brickDims[3];
+    std::uint32_t brickCount;
+    std::uint32_t reserved;
+};
+static_assert(sizeof(SdfFileHeader) == 56, "SdfFileHeader must stay tightly packed");
+
+std::size_t sampleIndex(const glm::uvec3& s, const glm::uvec3& sampleDims) {
+    return (static_cast<std::size_t>(s.z) * sampleDims.y + s.y) * sampleDims.x + s.x;
+}
+
+std::size_t brickSampleOffset(std::uint32_t x, std::uint32_t y, std::uint32_t z) {
+    return (static_cast<std::size_t>(z) * SdfGrid::kBrickSamples + y) * SdfGrid::kBrickSamples + x;
+}
+
+std::vector<glm::vec3> triangleCorners(const ObjMeshData& mesh) {
+    std::vector<glm::vec3> corners;
+    corners.reserve(mesh.indices.size());
+    for (const unsigned int index : mesh.indices) {
+        corners.push_back(mesh.vertices[index].position);
+    }
+    return corners;
+}
+
+// Inside/outside for every lattice sample by ray parity along +x. The ray origin is nudged off the lattice
+// so it never runs exactly through a shared edge or vertex of an axis-aligned mesh.
+std::vector<std::uint8_t> classifyInside(
+    const std::vector<glm::vec3>& corners,
+    const glm::vec3& origin,
+    float voxelSize,
+    const glm::uvec3& sampleDims) {
+    const std::size_t triangleCount = corners.size() / 3;
+    const float nudgeY = voxelSize * 1.3e-3f;
+    const float nudgeZ = voxelSize * 0.7e-3f;
+
+    std::vector<std::vector<std::uint32_t>> slabTriangles(sampleDims.z);
+    for (std::size_t t = 0; t < triangleCount; ++t) {
+        const float zMin = std::min(corners[3 * t].z, std::min(corners[3 * t + 1].z, corners[3 * t + 2].z));
+        const float zMax = std::max(corners[3 * t].z, std::max(corners[3 * t + 1].z, corners[3 * t + 2].z));
+        const long k0 = std::max(0L, static_cast<long>(std::floor((zMin - origin.z - nudgeZ) / voxelSize)));
+        const long k1 = std::min(static_cast<long>(sampleDims.z) - 1, static_cast<long>(std::ceil((zMax - origin.z - nudgeZ) / voxelSize)));
+        for (long k = k0; k <= k1; ++k) {
+            slabTriangles[static_cast<std::size_t>(k)].push_back(static_cast<std::uint32_t>(t));
+        }
+    }
+
+    std::vector<std::uint8_t> inside(static_cast<std::size_t>(sampleDims.x) * sampleDims.y * sampleDims.z, 0);
+    ThreadPool::shared().parallelFor(0, sampleDims.z, 1, [&](std::size_t begin, std::size_t end) {
+        std::vector<float> crossings;
+        for (std::size_t k = begin; k < end; ++k) {
+            const float z = origin.z + static_cast<float>(k) * voxelSize + nudgeZ;
+            for (std::uint32_t j = 0; j < sampleDims.y; ++j) {
+                const float y = origin.y + static_cast<float>(j) * voxelSize + nudgeY;
+                crossings.clear();
+                for (const std::uint32_t t : slabTriangles[k]) {
+                    const glm::vec3& a = corners[3 * t + 0];
+                    const glm::vec3& b = corners[3 * t + 1];
+                    const glm::vec3& c = corners[3 * t + 2];
+                    // Barycentric coordinates of (y, z) in the triangle's yz projection.
+                    const float det = (b.y - a.y) * (c.z - a.z) - (c.y - a.y) * (b.z - a.z);
+                    if (std::abs(det) <= 1e-12f) {
+                        continue;
+                    }
+                    const float u = ((y - a.y) * (c.z - a.z) - (c.y - a.y) * (z - a.z)) / det;
+                    const float v = ((b.y - a.y) * (z - a.z) - (y - a.y) * (b.z - a.z)) / det;
+                    if (u < 0.0f || v < 0.0f || u + v > 1.0f) {
+                        continue;
+                    }
+                    crossings.push_back(a.x + u * (b.x - a.x) + v * (c.x - a.x));
+                }
+                std::sort(crossings.begin(), crossings.end());
+
+                std::size_t passed = 0;
+                for (std::uint32_t i = 0; i < sampleDims.x; ++i) {
+                    const float x = origin.x + static_cast<float>(i) * voxelSize;
+                    while (passed < crossings.size() && crossings[passed] < x) {
+                        ++passed;
+                    }
+                    inside[sampleIndex(glm::uvec3(i, j, static_cast<std::uint32_t>(k)), sampleDims)] = passed & 1u;
+                }
+            }
+        }
+    });
+    return inside;
+}
+}  // namespace
+
+SdfGrid::SdfGrid()
+    : m_origin(0.0f),
+      m_voxelSize(0.0f),
+      m_bandWidth(0.0f),
+      m_brickDims(0u),
+      m_key(0),
+      m_brickCount(0),
+      m_table(nullptr),
+      m_samples(nullptr),
+      m_mapping(nullptr),
+      m_mappingSize(0) {}
+
+SdfGrid::~SdfGrid() {
+#if !defined(_WIN32)
+    if (m_mapping != nullptr) {
+        munmap(m_mapping, m_mappingSize);
+    }
+#endif
+}
+
+std::shared_ptr<SdfGrid> SdfGrid::bake(const ObjMeshData& mesh, float voxelSize, float bandWidth) {
+    if (mesh.indices.size() < 3) {
+        throw std::runtime_error("SDF bake needs at least one triangle");
+    }
+    if (voxelSize <= 0.0f || bandWidth < voxelSize) {
+        throw std::runtime_error("SDF bake needs voxelSize > 0 and bandWidth >= voxelSize");
+    }
+
+    const std::vector<glm::vec3> corners = triangleCorners(mesh);
+    const std::size_t triangleCount = corners.size() / 3;
+
+    glm::vec3 meshMin(std::numeric_limits<float>::max());
+    glm::vec3 meshMax(-std::numeric_limits<float>::max());
+    for (const glm::vec3& p : corners) {
+        meshMin = glm::min(meshMin, p);
+        meshMax = glm::max(meshMax, p);
+    }
+
+    std::shared_ptr<SdfGrid> grid(new SdfGrid());
+    const float pad = bandWidth + voxelSize;
+    grid->m_origin = meshMin - glm::vec3(pad);
+    grid->m_voxelSize = voxelSize;
+    grid->m_bandWidth = bandWidth;
+    grid->m_key = cacheKey(mesh, voxelSize, bandWidth);
+    for (int axis = 0; axis < 3; ++axis) {
+        const float cells = std::ceil((meshMax[axis] - meshMin[axis] + 2.0f * pad) / voxelSize);
+        grid->m_brickDims[axis] = std::max(1u, static_cast<std::uint32_t>(std::ceil(cells / static_cast<float>(kBrickCells))));
+    }
+
+    const glm::uvec3 brickDims = grid->m_brickDims;
+    const glm::uvec3 sampleDims = brickDims * kBrickCells + glm::uvec3(1u);
+    const std::vector<std::uint8_t> inside = classifyInside(corners, grid->m_origin, voxelSize, sampleDims);
+
+    std::vector<glm::vec3> triMin(triangleCount);
+    std::vector<glm::vec3> triMax(triangleCount);
+    for (std::size_t t = 0; t < triangleCount; ++t) {
+        triMin[t] = glm::min(corners[3 * t], glm::min(corners[3 * t + 1], corners[3 * t + 2]));
+        triMax[t] = glm::max(corners[3 * t], glm::max(corners[3 * t + 1], corners[3 * t + 2]));
+    }
+
+    const std::size_t totalBricks = static_cast<std::size_t>(brickDims.x) * brickDims.y * brickDims.z;
+    std::vector<std::int32_t> entries(totalBricks, kEmptyOutside);
+    std::vector<std::vector<float>> brickSamples(totalBricks);
+
+    ThreadPool::shared().parallelFor(0, totalBricks, 1, [&](std::size_t begin, std::size_t end) {
+        std::vector<std::uint32_t> candidates;
+        for (std::size_t b = begin; b < end; ++b) {
+            const glm::uvec3 brick(
+                static_cast<std::uint32_t>(b % brickDims.x),
+                static_cast<std::uint32_t>((b / brickDims.x) % brickDims.y),
+                static_cast<std::uint32_t>(b / (static_cast<std::size_t>(brickDims.x) * brickDims.y)));
+            const glm::uvec3 firstSample = brick * kBrickCells;
+            const glm::vec3 brickMin = grid->m_origin + glm::vec3(firstSample) * voxelSize;
+            const glm::vec3 brickMax = brickMin + glm::vec3(static_cast<float>(kBrickCells) * voxelSize);
+            const glm::uvec3 centerSample = firstSample + glm::uvec3(kBrickCells / 2);
+            const bool centerInside = inside[sampleIndex(centerSample, sampleDims)] != 0;
+
+            candidates.clear();
+            for (std::size_t t = 0; t < triangleCount; ++t) {
+                if (triMin[t].x <= brickMax.x + bandWidth && triMax[t].x >= brickMin.x - bandWidth &&
+                    triMin[t].y <= brickMax.y + bandWidth && triMax[t].y >= brickMin.y - bandWidth &&
+                    triMin[t].z <= brickMax.z + bandWidth && triMax[t].z >= brickMin.z - bandWidth) {
+                    candidates.push_back(static_cast<std::uint32_t>(t));
+                }
+            }
+            if (candidates.empty()) {
+                entries[b] = centerInside ? kEmptyInside : kEmptyOutside;
+                continue;
+            }
+
+            std::vector<float> values(kSamplesPerBrick);
+            bool touchesBand = false;
+            for (std::uint32_t z = 0; z < kBrickSamples; ++z) {
+                for (std::uint32_t y = 0; y < kBrickSamples; ++y) {
+                    for (std::uint32_t x = 0; x < kBrickSamples; ++x) {
+                        const glm::uvec3 s = firstSample + glm::uvec3(x, y, z);
+                        const glm::vec3 p = grid->m_origin + glm::vec3(s) * voxelSize;
+                        float best = bandWidth * bandWidth;
+                        for (const std::uint32_t t : candidates) {
+                            const glm::vec3 q = closestPointOnTriangle(p, corners[3 * t], corners[3 * t + 1], corners[3 * t + 2]);
+                            const glm::vec3 d = p - q;
+                            best = std::min(best, glm::dot(d, d));
+                        }
+                        const float distance = std::sqrt(best);
+                        touchesBand |= distance < bandWidth;
+                        values[brickSampleOffset(x, y, z)] = inside[sampleIndex(s, sampleDims)] != 0 ? -distance : distance;
+                    }
+                }
+            }
+
+            if (!touchesBand) {
+                entries[b] = centerInside ? kEmptyInside : kEmptyOutside;
+                continue;
+            }
+            entries[b] = 0;
+            brickSamples[b] = std::move(values);
+        }
+    });
+
+    grid->m_ownedTable = std::move(entries);
+    for (std::size_t b = 0; b < totalBricks; ++b) {
+        if (grid->m_ownedTable[b] < 0) {
+            continue;
+        }
+        grid->m_ownedTable[b] = static_cast<std::int32_t>(grid->m_brickCount++);
+        grid->m_ownedSamples.insert(grid->m_ownedSamples.end(), brickSamples[b].begin(), brickSamples[b].end());
+    }
+    grid->m_table = grid->m_ownedTable.data();
+    grid->m_samples = grid->m_ownedSamples.data();
+    return grid;
+}
+
+std::shared_ptr<SdfGrid> SdfGrid::load(const std::string& path) {
+    std::shared_ptr<SdfGrid> grid(new SdfGrid());
+    const unsigned char* bytes = nullptr;
+    std::size_t size = 0;
+
+#if defined(_WIN32)
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        throw std::runtime_error("Unable to open SDF cache: " + path);
+    }
+    std::vector<unsigned char> contents(static_cast<std::size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(contents.data()), static_cast<std::streamsize>(contents.size()));
+    bytes = contents.data();
+    size = contents.size();
+#else
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Unable to open SDF cache: " + path);
+    }
+    struct stat info {};
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        close(fd);
+        throw std::runtime_error("Unable to stat SDF cache: " + path);
+    }
+    size = static_cast<std::size_t>(info.st_size);
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Unable to map SDF cache: " + path);
+    }
+    grid->m_mapping = mapping;
+    grid->m_mappingSize = size;
+    bytes = static_cast<const unsigned char*>(mapping);
+#endif
+
+    if (size < sizeof(SdfFileHeader)) {
+        throw std::runtime_error("SDF cache is truncated: " + path);
+    }
+    SdfFileHeader header;
+    std::memcpy(&header, bytes, sizeof(header));
+    if (std::memcmp(header.magic, kFileMagic, sizeof(kFileMagic)) != 0 || header.version != kFileVersion) {
+        throw std::runtime_error("SDF cache has an unknown format: " + path);
+    }
+
+    grid->m_origin = glm::vec3(header.origin[0], header.origin[1], header.origin[2]);
+    grid->m_voxelSize = header.voxelSize;
+    grid->m_bandWidth = header.bandWidth;
+    grid->m_brickDims = glm::uvec3(header.brickDims[0], header.brickDims[1], header.brickDims[2]);
+    grid->m_brickCount = header.brickCount;
+    grid->m_key = header.key;
+
+    // Everything below comes straight from disk. Bound the header fields by the file size before multiplying them,
+    // so a corrupt entry cannot wrap the size check.
+    const std::uint64_t maxWords = size / sizeof(std::int32_t);
+    const glm::uvec3& dims = grid->m_brickDims;
+    const bool finiteHeader = std::isfinite(header.origin[0]) && std::isfinite(header.origin[1]) &&
+                              std::isfinite(header.origin[2]) && std::isfinite(header.voxelSize) &&
+                              std::isfinite(header.bandWidth) && header.voxelSize > 0.0f && header.bandWidth > 0.0f;
+    if (!finiteHeader || dims.x == 0 || dims.y == 0 || dims.z == 0 ||
+        static_cast<std::uint64_t>(dims.x) * dims.y > maxWords ||
+        dims.z > maxWords / (static_cast<std::uint64_t>(dims.x) * dims.y) ||
+        header.brickCount > maxWords / kSamplesPerBrick) {
+        throw std::runtime_error("SDF cache header is corrupt: " + path);
+    }
+
+    const std::size_t tableBytes = grid->brickTableSize() * sizeof(std::int32_t);
+    const std::size_t sampleBytes = grid->m_brickCount * kSamplesPerBrick * sizeof(float);
+    if (size != sizeof(SdfFileHeader) + tableBytes + sampleBytes) {
+        throw std::runtime_error("SDF cache size does not match its header: " + path);
+    }
+
+    const unsigned char* tableBegin = bytes + sizeof(SdfFileHeader);
+#if defined(_WIN32)
+    grid->m_ownedTable.resize(grid->brickTableSize());
+    grid->m_ownedSamples.resize(grid->m_brickCount * kSamplesPerBrick);
+    std::memcpy(grid->m_ownedTable.data(), tableBegin, tableBytes);
+    std::memcpy(grid->m_ownedSamples.data(), tableBegin + tableBytes, sampleBytes);
+    grid->m_table = grid->m_ownedTable.data();
+    grid->m_samples = grid->m_ownedSamples.data();
+#else
+    // The header is 8-byte sized and both arrays hold 4-byte elements, so the mapped pointers stay aligned.
+    grid->m_table = reinterpret_cast<const std::int32_t*>(tableBegin);
+    grid->m_samples = reinterpret_cast<const float*>(tableBegin + tableBytes);
+#endif
+
+    // The samplers index the sample array with table entries unchecked, so each entry must be an empty marker or
+    // name a stored brick, and the stored bricks must account for every brick of samples.
+    std::size_t storedBricks = 0;
+    for (std::size_t b = 0; b < grid->brickTableSize(); ++b) {
+        const std::int32_t entry = grid->m_table[b];
+        if (entry >= 0) {
+            if (static_cast<std::uint32_t>(entry) >= header.brickCount) {
+                throw std::runtime_error("SDF cache brick table points past its samples: " + path);
+            }
+            ++storedBricks;
+        } else if (entry != kEmptyOutside && entry != kEmptyInside) {
+            throw std::runtime_error("SDF cache brick table has an invalid entry: " + path);
+        }
+    }
+    if (storedBricks != grid->m_brickCount) {
+        throw std::runtime_error("SDF cache brick table does not match its sample count: " + path);
+    }
+    return grid;
+}
+
+std::shared_ptr<SdfGrid> SdfGrid::loadOrBake(
+    const ObjMeshData& mesh,
+    float voxelSize,
+    float bandWidth,
+    const std::string& cacheDirectory) {
+    const std::uint64_t key = cacheKey(mesh, voxelSize, bandWidth);
+    const std::string path = cachePath(cacheDirectory, key);
+
+    std::error_code ec;
+    if (std::filesystem::exists(path, ec)) {
+        try {
+            std::shared_ptr<SdfGrid> cached = load(path);
+            if (cached->key() == key) {
+                return cached;
+            }
+        } catch (const std::runtime_error&) {
+            // Stale or corrupt cache entry: fall through and rebake over it.
+        }
+    }
+
+    std::shared_ptr<SdfGrid> grid = bake(mesh, voxelSize, bandWidth);
+    try {
+        grid->save(path);
+    } catch (const std::runtime_error&) {
+        // The cache is only an accelerator; a read-only tree still gets a freshly baked grid.
+    }
+    return grid;
+}
+
+std::uint64_t SdfGrid::cacheKey(const ObjMeshData& mesh, float voxelSize, float bandWidth) {
+    std::uint64_t hash = fnv1a64(&kFileVersion, sizeof(kFileVersion));
+    hash = fnv1a64(&voxelSize, sizeof(voxelSize), hash);
+    hash = fnv1a64(&bandWidth, sizeof(bandWidth), hash);
+    for (const unsigned int index : mesh.indices) {
+        const glm::vec3& p = mesh.vertices[index].position;
+        const float xyz[3] = {p.x, p.y, p.z};
+        hash = fnv1a64(xyz, sizeof(xyz), hash);
+    }
+    return hash;
+}
+
+std::string SdfGrid::cachePath(const std::string& cacheDirectory, std::uint64_t key) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.sdf", static_cast<unsigned long long>(key));
+    return (std::filesystem::path(cacheDirectory) / name).string();
+}
+
+void SdfGrid::save(const std::string& path) const {
+    const std::filesystem::path target(path);
+    std::error_code ec;
+    if (target.has_parent_path()) {
+        std::filesystem::create_directories(target.parent_path(), ec);
+    }
+
+    SdfFileHeader header{};
+    std::memcpy(header.magic, kFileMagic, sizeof(kFileMagic));
+    header.version = kFileVersion;
+    header.key = m_key;
+    header.origin[0] = m_origin.x;
+    header.origin[1] = m_origin.y;
+    header.origin[2] = m_origin.z;
+    header.voxelSize = m_voxelSize;
+    header.bandWidth = m_bandWidth;
+    header.brickDims[0] = m_brickDims.x;
+    header.brickDims[1] = m_brickDims.y;
+    header.brickDims[2] = m_brickDims.z;
+    header.brickCount = static_cast<std::uint32_t>(m_brickCount);
+
+    // Write beside the target and rename, so a concurrent reader never maps a half-written file.
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("Unable to write SDF cache: " + temporary);
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(m_table), static_cast<std::streamsize>(brickTableSize() * sizeof(std::int32_t)));
+        file.write(
+            reinterpret_cast<const char*>(m_samples),
+            static_cast<std::streamsize>(m_brickCount * kSamplesPerBrick * sizeof(float)));
+        if (!file) {
+            throw std::runtime_error("Unable to write SDF cache: " + temporary);
+        }
+    }
+    std::filesystem::rename(temporary, target, ec);
+    if (ec) {
+        std::filesystem::remove(temporary, ec);
+        throw std::runtime_error("Unable to move SDF cache into place: " + path);
+    }
+}
+
+bool SdfGrid::locateCell(const glm::vec3& p, std::int32_t& entry, glm::uvec3& local, glm::vec3& fraction) const {
+    const glm::vec3 gridPos = (p - m_origin) / m_voxelSize;
+    const glm::vec3 cells = glm::vec3(m_brickDims * kBrickCells);
+    if (gridPos.x < 0.0f || gridPos.y < 0.0f || gridPos.z < 0.0f || gridPos.x >= cells.x || gridPos.y >= cells.y ||
+        gridPos.z >= cells.z) {
+        return false;
+    }
+
+    const glm::uvec3 cell(glm::floor(gridPos));
+    const glm::uvec3 brick(cell.x / kBrickCells, cell.y / kBrickCells, cell.z / kBrickCells);
+    local = cell - brick * kBrickCells;
+    fraction = gridPos - glm::vec3(cell);
+    entry = m_table[(static_cast<std::size_t>(brick.z) * m_brickDims.y + brick.y) * m_brickDims.x + brick.x];
+    return true;
+}
+
+float SdfGrid::sample(const glm::vec3& p, glm::vec3* gradient) const {
+    std::int32_t entry = kEmptyOutside;
+    glm::uvec3 local(0u);
+    glm::vec3 f(0.0f);
+    if (!locateCell(p, entry, local, f)) {
+        return m_bandWidth;
+    }
+    if (entry < 0) {
+        return entry == kEmptyInside ? -m_bandWidth : m_bandWidth;
+    }
+
+    const float* brick = m_samples + static_cast<std::size_t>(entry) * kSamplesPerBrick;
+    const auto at = [&](std::uint32_t dx, std::uint32_t dy, std::uint32_t dz) {
+        return brick[brickSampleOffset(local.x + dx, local.y + dy, local.z + dz)];
+    };
+    const float c000 = at(0, 0, 0);
+    const float c100 = at(1, 0, 0);
+    const float c010 = at(0, 1, 0);
+    const float c110 = at(1, 1, 0);
+    const float c001 = at(0, 0, 1);
+    const float c101 = at(1, 0, 1);
+    const float c011 = at(0, 1, 1);
+    const float c111 = at(1, 1, 1);
+
+    const float x00 = c000 + (c100 - c000) * f.x;
+    const float x10 = c010 + (c110 - c010) * f.x;
+    const float x01 = c001 + (c101 - c001) * f.x;
+    const float x11 = c011 + (c111 - c011) * f.x;
+    const float y0 = x00 + (x10 - x00) * f.y;
+    const float y1 = x01 + (x11 - x01) * f.y;
+
+    if (gradient != nullptr) {
+        const float dx0 = (c100 - c000) + ((c110 - c010) - (c100 - c000)) * f.y;
+        const float dx1 = (c101 - c001) + ((c111 - c011) - (c101 - c001)) * f.y;
+        const float dx = dx0 + (dx1 - dx0) * f.z;
+        const float dy = (x10 - x00) + ((x11 - x01) - (x10 - x00)) * f.z;
+        const float dz = y1 - y0;
+        *gradient = glm::vec3(dx, dy, dz) / m_voxelSize;
+    }
+    return y0 + (y1 - y0) * f.z;
+}
+
+bool SdfGrid::inNarrowBand(const glm::vec3& p) const {
+    std::int32_t entry = kEmptyOutside;
+    glm::uvec3 local(0u);
+    glm::vec3 fraction(0.0f);
+    return locateCell(p, entry, local, fraction) && entry >= 0;
+}
+
+const glm::vec3& SdfGrid::origin() const {
+    return m_origin;
+}
+
+float SdfGrid::voxelSize() const {
+    return m_voxelSize;
+}
+
+float SdfGrid::bandWidth() const {
+    return m_bandWidth;
+}
+
+glm::vec3 SdfGrid::boundsMax() const {
+    return m_origin + glm::vec3(m_brickDims * kBrickCells) * m_voxelSize;
+}
+
+const glm::uvec3& SdfGrid::brickDims() const {
+    return m_brickDims;
+}
+
+const std::int32_t* SdfGrid::brickTable() const {
+    return m_table;
+}
+
+std::size_t SdfGrid::brickTableSize() const {
+    return static_cast<std::size_t>(m_brickDims.x) * m_brickDims.y * m_brickDims.z;
+}
+
+const float* SdfGrid::samples() const {
+    return m_samples;
+}
+
+std::size_t SdfGrid::brickCount() const {
+    return m_brickCount;
+}
+
+std::uint64_t SdfGrid::key() const {
+    return m_key;
+}
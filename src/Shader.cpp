@@ -3,34 +3,19 @@
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 
 #include <GL/glew.h>
 
+#include "ProgramCache.h"
+
 Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath) : m_programId(0) {
     const std::string vertexSource = readFile(vertexPath);
     const std::string fragmentSource = readFile(fragmentPath);
 
-    const unsigned int vertexShader = compile(GL_VERTEX_SHADER, vertexSource);
-    const unsigned int fragmentShader = compile(GL_FRAGMENT_SHADER, fragmentSource);
-
-    m_programId = glCreateProgram();
-    glAttachShader(m_programId, vertexShader);
-    glAttachShader(m_programId, fragmentShader);
-    glLinkProgram(m_programId);
-
-    int success = 0;
-    glGetProgramiv(m_programId, GL_LINK_STATUS, &success);
-    if (success == 0) {
-        int logLength = 0;
-        glGetProgramiv(m_programId, GL_INFO_LOG_LENGTH, &logLength);
-        std::vector<char> log(static_cast<std::size_t>(logLength));
-        glGetProgramInfoLog(m_programId, logLength, nullptr, log.data());
-        throw std::runtime_error("Shader link failed: " + std::string(log.data()));
-    }
-
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    m_programId = ProgramCache::build({{GL_VERTEX_SHADER, vertexSource}, {GL_FRAGMENT_SHADER, fragmentSource}});
+    reflectUniforms();
 }
 
 Shader::~Shader() {
@@ -47,26 +32,72 @@ unsigned int Shader::id() const {
     return m_programId;
 }
 
+void Shader::bindUniformBlock(const std::string& blockName, unsigned int binding) const {
+    const unsigned int blockIndex = glGetUniformBlockIndex(m_programId, blockName.c_str());
+    if (blockIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(m_programId, blockIndex, binding);
+    }
+}
+
 void Shader::setMat4(const std::string& name, const glm::mat4& value) const {
-    const int location = glGetUniformLocation(m_programId, name.c_str());
+    const int location = uniformLocation(name);
     glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]);
 }
 
 void Shader::setVec3(const std::string& name, const glm::vec3& value) const {
-    const int location = glGetUniformLocation(m_programId, name.c_str());
+    const int location = uniformLocation(name);
     glUniform3fv(location, 1, &value[0]);
 }
 
 void Shader::setFloat(const std::string& name, float value) const {
-    const int location = glGetUniformLocation(m_programId, name.c_str());
+    const int location = uniformLocation(name);
     glUniform1f(location, value);
 }
 
 void Shader::setInt(const std::string& name, int value) const {
-    const int location = glGetUniformLocation(m_programId, name.c_str());
+    const int location = uniformLocation(name);
     glUniform1i(location, value);
 }
 
+// Uniform block members are left out: they report location -1 and are written through their buffers.
+void Shader::reflectUniforms() {
+    int uniformCount = 0;
+    int maxNameLength = 0;
+    glGetProgramiv(m_programId, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(m_programId, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    std::vector<char> nameBuffer(static_cast<std::size_t>(maxNameLength) + 1, '\0');
+    for (int i = 0; i < uniformCount; ++i) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(
+            m_programId,
+            static_cast<GLuint>(i),
+            static_cast<GLsizei>(nameBuffer.size()),
+            &length,
+            &size,
+            &type,
+            nameBuffer.data());
+        std::string name(nameBuffer.data(), static_cast<std::size_t>(length));
+        const int location = glGetUniformLocation(m_programId, name.c_str());
+        if (location < 0) {
+            continue;
+        }
+        // Arrays are reported as "name[0]"; callers use the bare name for the first element.
+        const std::size_t bracket = name.find("[0]");
+        if (bracket != std::string::npos && bracket + 3 == name.size()) {
+            name.erase(bracket);
+        }
+        m_uniformLocations.emplace(std::move(name), location);
+    }
+}
+
+int Shader::uniformLocation(const std::string& name) const {
+    const auto it = m_uniformLocations.find(name);
+    return it != m_uniformLocations.end() ? it->second : -1;
+}
+
 std::string Shader::readFile(const std::string& path) {
     std::ifstream file(path);
     if (!file.is_open()) {
@@ -77,22 +108,3 @@ std::string Shader::readFile(const std::string& path) {
     buffer << file.rdbuf();
     return buffer.str();
 }
-
-unsigned int Shader::compile(unsigned int type, const std::string& source) {
-    const unsigned int shader = glCreateShader(type);
-    const char* ptr = source.c_str();
-    glShaderSource(shader, 1, &ptr, nullptr);
-    glCompileShader(shader);
-
-    int success = 0;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (success == 0) {
-        int logLength = 0;
-        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
-        std::vector<char> log(static_cast<std::size_t>(logLength));
-        glGetShaderInfoLog(shader, logLength, nullptr, log.data());
-        throw std::runtime_error("Shader compile failed: " + std::string(log.data()));
-    }
-
-    return shader;
-}
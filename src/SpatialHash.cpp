@@ -0,0 +1,113 @@
+#include "SpatialHash.h"
+
+#include <algorithm>
+
+#include "ThreadPool.h"
+
+namespace {
+constexpr std::size_t kHashGrain = 4096;
+constexpr std::uint32_t kMaxDigitBits = 8;
+constexpr std::size_t kDigitGrain = 8;
+}  // namespace
+
+std::uint32_t SpatialHash::tableSizeFor(std::size_t particleCount) {
+    std::uint32_t size = 64;
+    while (size < 2 * particleCount) {
+        size <<= 1;
+    }
+    return size;
+}
+
+void SpatialHash::build(const std::vector<glm::vec3>& positions, float cellSize) {
+    const std::size_t count = positions.size();
+    const std::uint32_t tableSize = tableSizeFor(count);
+    m_invCellSize = 1.0f / cellSize;
+    m_tableMask = tableSize - 1;
+
+    m_particleCell.resize(count);
+    m_particleBucket.resize(count);
+    m_sortedParticles.resize(count);
+    m_digitSorted.resize(count);
+    m_bucketStart.resize(static_cast<std::size_t>(tableSize) + 1);
+    m_bucketCursor.resize(tableSize);
+
+    // Two-level stable counting sort. The top bits of the bucket (the digit) are sorted across particle chunks
+    // with per-chunk histograms, then each digit owns a disjoint range of buckets and is sorted on its own. Both
+    // levels run on the pool and keep scratch at O(particles + chunks * digits) rather than O(chunks * buckets).
+    std::uint32_t tableBits = 0;
+    while ((1u << tableBits) < tableSize) {
+        ++tableBits;
+    }
+    const std::uint32_t digitShift = tableBits - std::min(tableBits, kMaxDigitBits);
+    const std::size_t digitCount = static_cast<std::size_t>(tableSize >> digitShift);
+
+    ThreadPool& pool = ThreadPool::shared();
+    const std::size_t chunkCount =
+        std::max<std::size_t>(1, std::min<std::size_t>(pool.workerCount() + 1, (count + kHashGrain - 1) / kHashGrain));
+    const std::size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+    m_chunkDigitOffset.assign(chunkCount * digitCount, 0);
+    m_digitStart.resize(digitCount + 1);
+
+    pool.parallelFor(0, chunkCount, 1, [&](std::size_t chunkBegin, std::size_t chunkEnd) {
+        for (std::size_t chunk = chunkBegin; chunk < chunkEnd; ++chunk) {
+            std::uint32_t* histogram = &m_chunkDigitOffset[chunk * digitCount];
+            const std::size_t end = std::min(count, (chunk + 1) * chunkSize);
+            for (std::size_t i = chunk * chunkSize; i < end; ++i) {
+                m_particleCell[i] = cellOf(positions[i]);
+                m_particleBucket[i] = bucketOf(m_particleCell[i]);
+                ++histogram[m_particleBucket[i] >> digitShift];
+            }
+        }
+    });
+
+    // Exclusive scan in (digit, chunk) order: within a digit, earlier chunks come first, which keeps the sort stable.
+    std::uint32_t running = 0;
+    for (std::size_t digit = 0; digit < digitCount; ++digit) {
+        m_digitStart[digit] = running;
+        for (std::size_t chunk = 0; chunk < chunkCount; ++chunk) {
+            std::uint32_t& slot = m_chunkDigitOffset[chunk * digitCount + digit];
+            const std::uint32_t digitCountInChunk = slot;
+            slot = running;
+            running += digitCountInChunk;
+        }
+    }
+    m_digitStart[digitCount] = running;
+
+    pool.parallelFor(0, chunkCount, 1, [&](std::size_t chunkBegin, std::size_t chunkEnd) {
+        for (std::size_t chunk = chunkBegin; chunk < chunkEnd; ++chunk) {
+            std::uint32_t* cursor = &m_chunkDigitOffset[chunk * digitCount];
+            const std::size_t end = std::min(count, (chunk + 1) * chunkSize);
+            for (std::size_t i = chunk * chunkSize; i < end; ++i) {
+                m_digitSorted[cursor[m_particleBucket[i] >> digitShift]++] = static_cast<std::uint32_t>(i);
+            }
+        }
+    });
+
+    // Per digit: histogram, scan and stable scatter over its own buckets and its own slice of the output.
+    pool.parallelFor(0, digitCount, kDigitGrain, [&](std::size_t digitBegin, std::size_t digitEnd) {
+        for (std::size_t digit = digitBegin; digit < digitEnd; ++digit) {
+            const std::size_t bucketBegin = digit << digitShift;
+            const std::size_t bucketEnd = (digit + 1) << digitShift;
+            std::fill(m_bucketCursor.begin() + bucketBegin, m_bucketCursor.begin() + bucketEnd, 0u);
+            for (std::uint32_t s = m_digitStart[digit]; s < m_digitStart[digit + 1]; ++s) {
+                ++m_bucketCursor[m_particleBucket[m_digitSorted[s]]];
+            }
+            std::uint32_t start = m_digitStart[digit];
+            for (std::size_t b = bucketBegin; b < bucketEnd; ++b) {
+                const std::uint32_t bucketCount = m_bucketCursor[b];
+                m_bucketStart[b] = start;
+                m_bucketCursor[b] = start;
+                start += bucketCount;
+            }
+            for (std::uint32_t s = m_digitStart[digit]; s < m_digitStart[digit + 1]; ++s) {
+                const std::uint32_t particle = m_digitSorted[s];
+                m_sortedParticles[m_bucketCursor[m_particleBucket[particle]]++] = particle;
+            }
+        }
+    });
+    m_bucketStart[tableSize] = static_cast<std::uint32_t>(count);
+}
+
+const std::vector<std::uint32_t>& SpatialHash::sortedParticles() const {
+    return m_sortedParticles;
+}
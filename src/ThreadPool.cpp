@@ -0,0 +1,131 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <utility>
+
+ThreadPool::ThreadPool(unsigned int workerCount)
+    : m_body(nullptr),
+      m_begin(0),
+      m_end(0),
+      m_grain(1),
+      m_chunkCount(0),
+      m_nextChunk(0),
+      m_generation(0),
+      m_busyWorkers(0),
+      m_running(false),
+      m_stop(false) {
+    m_workers.reserve(workerCount);
+    for (unsigned int i = 0; i < workerCount; ++i) {
+        m_workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1u);
+    return pool;
+}
+
+std::size_t ThreadPool::workerCount() const {
+    return m_workers.size();
+}
+
+void ThreadPool::parallelFor(
+    std::size_t begin,
+    std::size_t end,
+    std::size_t grain,
+    const std::function<void(std::size_t, std::size_t)>& body) {
+    if (begin >= end) {
+        return;
+    }
+
+    grain = std::max<std::size_t>(grain, 1);
+    const std::size_t chunkCount = (end - begin + grain - 1) / grain;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // Small ranges, a pool without workers, and nested calls from inside a body all run inline.
+    if (chunkCount <= 1 || m_workers.empty() || m_running) {
+        lock.unlock();
+        body(begin, end);
+        return;
+    }
+
+    m_body = &body;
+    m_begin = begin;
+    m_end = end;
+    m_grain = grain;
+    m_chunkCount = chunkCount;
+    m_nextChunk.store(0, std::memory_order_relaxed);
+    m_busyWorkers = m_workers.size();
+    m_running = true;
+    ++m_generation;
+    lock.unlock();
+    m_wake.notify_all();
+
+    runChunks();
+
+    lock.lock();
+    m_done.wait(lock, [this] { return m_busyWorkers == 0; });
+    m_running = false;
+    m_body = nullptr;
+    std::exception_ptr error = std::move(m_error);
+    m_error = nullptr;
+    lock.unlock();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::workerLoop() {
+    std::uint64_t seenGeneration = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stop || m_generation != seenGeneration; });
+            if (m_stop) {
+                return;
+            }
+            seenGeneration = m_generation;
+        }
+
+        runChunks();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_busyWorkers;
+        }
+        m_done.notify_one();
+    }
+}
+
+void ThreadPool::runChunks() {
+    for (;;) {
+        const std::size_t chunk = m_nextChunk.fetch_add(1, std::memory_order_relaxed);
+        if (chunk >= m_chunkCount) {
+            return;
+        }
+        const std::size_t chunkBegin = m_begin + chunk * m_grain;
+        const std::size_t chunkEnd = std::min(m_end, chunkBegin + m_grain);
+        try {
+            (*m_body)(chunkBegin, chunkEnd);
+        } catch (...) {
+            // Claim every remaining chunk so the other threads drain quickly; only the first error is kept.
+            m_nextChunk.store(m_chunkCount, std::memory_order_relaxed);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_error) {
+                m_error = std::current_exception();
+            }
+            return;
+        }
+    }
+}
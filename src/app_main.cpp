@@ -2,6 +2,7 @@
 #include <array>
 #include <chrono>
 #include <cmath>
+#include <cstdlib>
 #include <iostream>
 #include <memory>
 #include <stdexcept>
@@ -18,9 +19,19 @@
 #include <backends/imgui_impl_opengl3.h>
 
 #include "Camera.h"
+#include "ColliderSet.h"
+#include "GpuClothBatch.h"
+#include "GpuKernelAutotuner.h"
 #include "GpuPhysicsSolver.h"
+#include "GpuTimer.h"
 #include "Mesh.h"
+#include "ObjLoader.h"
 #include "PhysicsSolver.h"
+#include "ProgramCache.h"
+#include "RenderUniforms.h"
+#include "SceneBvh.h"
+#include "SceneInstances.h"
+#include "SdfGrid.h"
 #include "Shader.h"
 
 namespace {
@@ -28,6 +39,23 @@ constexpr int kWindowWidth = 1280;
 constexpr int kWindowHeight = 720;
 constexpr int kShadowWidth = 3072;
 constexpr int kShadowHeight = 3072;
+constexpr float kPedestalVoxelSize = 0.02f;
+constexpr float kPedestalBandWidth = 0.08f;
+// Off-screen GpuClothBatch load for measuring batched dispatch cost.
+constexpr std::size_t kBannerGridSide = 16;
+constexpr std::size_t kBannerRows = 12;
+constexpr std::size_t kBannerCols = 8;
+// Winning step-kernel shape and storage layout per driver; CLOTH_AUTOTUNE=1 re-measures at startup.
+constexpr const char* kAutotunePath = "cache/autotune.txt";
+
+enum GpuTimerSection : std::size_t {
+    kTimerSolver,
+    kTimerShadow,
+    kTimerMain,
+    kTimerUi,
+    kTimerBatch,
+    kTimerSectionCount,
+};
 
 struct AppContext {
     Camera* camera = nullptr;
@@ -49,6 +77,18 @@ struct Ray {
     glm::vec3 direction;
 };
 
+const char* particleLayoutName(GpuParticleLayout layout) {
+    switch (layout) {
+    case GpuParticleLayout::Packed:
+        return "packed";
+    case GpuParticleLayout::PackedHalfVelocity:
+        return "fp16 vel";
+    case GpuParticleLayout::Vec4:
+        break;
+    }
+    return "vec4";
+}
+
 bool uiCapturingMouse() {
     return ImGui::GetCurrentContext() != nullptr && ImGui::GetIO().WantCaptureMouse;
 }
@@ -174,36 +214,24 @@ Ray screenPointToRay(float mouseX, float mouseY, int fbWidth, int fbHeight, cons
     return ray;
 }
 
-void drawSceneDepth(const Shader& depthShader, const Mesh& clothMesh, const std::vector<SceneObject>& sceneObjects) {
-    depthShader.setMat4("uModel", glm::mat4(1.0f));
-    clothMesh.draw();
-
-    for (const SceneObject& obj : sceneObjects) {
-        depthShader.setMat4("uModel", obj.model);
-        obj.mesh->draw();
+void drawSceneDepth(const Mesh& clothMesh, bool clothVisible, const SceneInstances& sceneInstances) {
+    if (clothVisible) {
+        Mesh::setCurrentInstance(Mesh::makeInstance(glm::mat4(1.0f), 0));
+        clothMesh.drawDepth();
     }
+    sceneInstances.drawDepth();
 }
 
 void drawSceneMain(
-    const Shader& shader,
     const Mesh& clothMesh,
-    const std::vector<SceneObject>& sceneObjects,
-    const glm::vec3& clothColor,
-    float clothSpec,
-    float clothShininess) {
-    shader.setMat4("uModel", glm::mat4(1.0f));
-    shader.setVec3("uBaseColor", clothColor);
-    shader.setFloat("uSpecularStrength", clothSpec);
-    shader.setFloat("uShininess", clothShininess);
-    clothMesh.draw();
-
-    for (const SceneObject& obj : sceneObjects) {
-        shader.setMat4("uModel", obj.model);
-        shader.setVec3("uBaseColor", obj.color);
-        shader.setFloat("uSpecularStrength", obj.specularStrength);
-        shader.setFloat("uShininess", obj.shininess);
-        obj.mesh->draw();
+    bool clothVisible,
+    const SceneInstances& sceneInstances,
+    std::uint32_t clothMaterial) {
+    if (clothVisible) {
+        Mesh::setCurrentInstance(Mesh::makeInstance(glm::mat4(1.0f), clothMaterial));
+        clothMesh.draw();
     }
+    sceneInstances.draw();
 }
 
 }  // namespace
@@ -240,6 +268,8 @@ int main() {
         }
 
         glEnable(GL_DEPTH_TEST);
+        // Linked shader binaries, keyed by source and driver; see ProgramCache.
+        ProgramCache::setDirectory("cache/shaders");
 
         const std::size_t rows = 35;
         const std::size_t cols = 35;
@@ -250,14 +280,24 @@ int main() {
 
         Shader shadingShader("shaders/vertex.glsl", "shaders/fragment.glsl");
         Shader depthShader("shaders/shadow_depth_vertex.glsl", "shaders/shadow_depth_fragment.glsl");
+        RenderUniforms renderUniforms;
+        renderUniforms.attach(shadingShader);
+        renderUniforms.attach(depthShader);
+        shadingShader.use();
+        shadingShader.setInt("uShadowMap", 0);
+        const std::uint32_t clothMaterial = renderUniforms.addMaterial(glm::vec3(0.79f, 0.30f, 0.24f), 0.36f, 36.0f);
         Camera camera(static_cast<float>(kWindowWidth) / static_cast<float>(kWindowHeight));
 
         std::unique_ptr<GpuPhysicsSolver> gpuSolver;
         bool gpuAvailable = false;
         std::string gpuInitError;
+        GpuKernelConfig kernelConfig;
+        bool kernelConfigKnown = false;
         if (GLEW_VERSION_4_3) {
             try {
-                gpuSolver = std::make_unique<GpuPhysicsSolver>(rows, cols, spacing);
+                kernelConfigKnown = GpuKernelAutotuner::load(kAutotunePath, rows, cols, kernelConfig);
+                gpuSolver = std::make_unique<GpuPhysicsSolver>(rows, cols, spacing, kernelConfig.layout);
+                gpuSolver->setStepKernelOptions(kernelConfig.options);
                 gpuAvailable = true;
             } catch (const std::exception& e) {
                 gpuInitError = e.what();
@@ -287,6 +327,37 @@ int main() {
         sceneObjects.push_back({cubeMesh, trs(glm::vec3(-4.5f, 0.8f, 0.0f), glm::vec3(0.12f, 4.0f, 9.0f)), glm::vec3(0.69f, 0.72f, 0.76f), 0.10f, 8.0f});
         sceneObjects.push_back({cubeMesh, trs(glm::vec3(0.0f, 2.48f, -0.85f), glm::vec3(2.15f, 0.06f, 0.06f)), glm::vec3(0.86f, 0.86f, 0.88f), 0.30f, 22.0f});
 
+        auto colliders = std::make_shared<ColliderSet>();
+        for (const SceneObject& obj : sceneObjects) {
+            colliders->addBox(obj.model);
+        }
+
+        // The pedestal collides through a baked SDF, cached on disk by mesh hash (see tools/sdf_bake.cpp).
+        const ObjMeshData pedestalData = ObjLoader::load("assets/models/pedestal.obj");
+        const glm::mat4 pedestalModel = trs(glm::vec3(0.0f, 0.28f, -0.7f), glm::vec3(1.0f));
+        auto pedestalMesh = std::make_shared<Mesh>(pedestalData.vertices, pedestalData.indices, false);
+        sceneObjects.push_back({pedestalMesh, pedestalModel, glm::vec3(0.62f, 0.48f, 0.36f), 0.22f, 14.0f});
+        colliders->addSdf(SdfGrid::loadOrBake(pedestalData, kPedestalVoxelSize, kPedestalBandWidth, "cache/sdf"), pedestalModel);
+        colliders->build();
+
+        SceneInstances sceneInstances;
+        for (const SceneObject& obj : sceneObjects) {
+            sceneInstances.add(
+                obj.mesh,
+                obj.model,
+                renderUniforms.addMaterial(obj.color, obj.specularStrength, obj.shininess));
+        }
+        sceneInstances.upload();
+
+        cpuSolver.setColliders(colliders);
+        if (gpuSolver) {
+            try {
+                gpuSolver->setColliders(colliders);
+            } catch (const std::exception& e) {
+                gpuInitError = e.what();
+            }
+        }
+
         unsigned int depthMapFbo = 0;
         unsigned int depthMap = 0;
         glGenFramebuffers(1, &depthMapFbo);
@@ -322,6 +393,9 @@ int main() {
 
         bool paused = false;
         bool wireframe = false;
+        // Last frame's cloth culling results, shown by the HUD before this frame culls.
+        bool clothInMainPass = true;
+        bool clothInShadowPass = true;
         bool showHud = true;
         bool pPressedLastFrame = false;
         bool f1PressedLastFrame = false;
@@ -335,16 +409,84 @@ int main() {
         float damping = cpuSolver.getDamping();
         float gravity = cpuSolver.getGravityScale();
         float wind = cpuSolver.getWindStrength();
+        bool selfCollision = cpuSolver.isSelfCollisionEnabled();
+        std::unique_ptr<GpuClothBatch> bannerBatch;
+        bool bannersEnabled = false;
 
+        // GPU times come from timer queries and trail the current frame by one; submit time is CPU-side.
+        GpuTimer gpuTimer(kTimerSectionCount);
         double cpuStepMs = 0.0;
         double gpuStepMs = 0.0;
+        double gpuSubmitMs = 0.0;
         double cpuGpuRmse = 0.0;
         double compareAccumSec = 0.0;
         double compareAccumCpuMs = 0.0;
         double compareAccumGpuMs = 0.0;
-        double compareAccumRmse = 0.0;
+        double compareAccumShadowMs = 0.0;
+        double compareAccumMainMs = 0.0;
+        double compareAccumUiMs = 0.0;
         int compareSamples = 0;
 
+        // Buffers and kernels are built for one layout, so switching rebuilds the solver and restarts both
+        // solvers from rest to keep the RMSE comparison meaningful.
+        const auto rebuildGpuSolver = [&](GpuParticleLayout layout) {
+            try {
+                auto rebuilt = std::make_unique<GpuPhysicsSolver>(rows, cols, spacing, layout);
+                rebuilt->setColliders(colliders);
+                rebuilt->setStiffness(stiffness);
+                rebuilt->setDamping(damping);
+                rebuilt->setGravityScale(gravity);
+                rebuilt->setWindStrength(wind);
+                rebuilt->setSelfCollisionEnabled(selfCollision);
+                rebuilt->setStepKernel(gpuSolver->stepKernel());
+                rebuilt->setStepKernelOptions(gpuSolver->stepKernelOptions());
+                rebuilt->setStrainIterations(gpuSolver->strainIterations());
+                rebuilt->setCgIterations(gpuSolver->cgIterations());
+                gpuSolver = std::move(rebuilt);
+                gpuInitError.clear();
+                clothMesh.setExternalStreams(0, 0, 0);
+
+                cpuSolver.reset();
+                cpuSolver.setStiffness(stiffness);
+                cpuSolver.setDamping(damping);
+                cpuSolver.setGravityScale(gravity);
+                cpuSolver.setWindStrength(wind);
+            } catch (const std::exception& e) {
+                gpuInitError = e.what();
+            }
+        };
+
+        // Measures every candidate against the live scene, persists the winner and switches the solver to it.
+        const auto autotuneGpuSolver = [&]() {
+            try {
+                GpuKernelConfig tuned = GpuKernelAutotuner::tune(rows, cols, spacing, colliders);
+                tuned.options.bendSprings = gpuSolver->stepKernelOptions().bendSprings;
+                kernelConfig = tuned;
+                kernelConfigKnown = true;
+                std::cout << "[Autotune] " << GpuKernelAutotuner::deviceKey() << ": "
+                          << particleLayoutName(tuned.layout) << ' ' << tuned.options.groupSizeX << 'x'
+                          << tuned.options.groupSizeY << ", " << tuned.stepMilliseconds << " ms/step\n";
+                GpuKernelAutotuner::save(kAutotunePath, rows, cols, tuned);
+            } catch (const std::exception& e) {
+                gpuInitError = e.what();
+            }
+            if (kernelConfigKnown && kernelConfig.layout != gpuSolver->particleLayout()) {
+                rebuildGpuSolver(kernelConfig.layout);
+            }
+            if (kernelConfigKnown) {
+                try {
+                    gpuSolver->setStepKernelOptions(kernelConfig.options);
+                } catch (const std::exception& e) {
+                    gpuInitError = e.what();
+                }
+            }
+        };
+
+        const char* autotuneEnv = std::getenv("CLOTH_AUTOTUNE");
+        if (gpuAvailable && autotuneEnv != nullptr && std::string(autotuneEnv) != "0") {
+            autotuneGpuSolver();
+        }
+
         float lastTime = static_cast<float>(glfwGetTime());
 
         while (!glfwWindowShouldClose(window)) {
@@ -354,6 +496,9 @@ int main() {
 
             glfwPollEvents();
 
+            gpuTimer.beginFrame();
+            gpuStepMs = gpuTimer.milliseconds(kTimerSolver);
+
             ImGui_ImplOpenGL3_NewFrame();
             ImGui_ImplGlfw_NewFrame();
             ImGui::NewFrame();
@@ -405,7 +550,7 @@ int main() {
 
             if (showHud) {
                 ImGui::SetNextWindowPos(ImVec2(16.0f, 16.0f), ImGuiCond_Always);
-                ImGui::SetNextWindowSize(ImVec2(360.0f, 320.0f), ImGuiCond_Always);
+                ImGui::SetNextWindowSize(ImVec2(360.0f, 664.0f), ImGuiCond_Always);
                 ImGui::Begin("Simulation", nullptr, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize);
 
                 int solverMode = useGpuSolver ? 1 : 0;
@@ -455,14 +600,138 @@ int main() {
                         gpuSolver->setWindStrength(wind);
                     }
                 }
+                if (ImGui::Checkbox("Self Collision", &selfCollision)) {
+                    cpuSolver.setSelfCollisionEnabled(selfCollision);
+                    if (gpuAvailable) {
+                        gpuSolver->setSelfCollisionEnabled(selfCollision);
+                    }
+                }
+                if (gpuAvailable) {
+                    int stepKernel = static_cast<int>(gpuSolver->stepKernel());
+                    ImGui::Text("GPU Kernel");
+                    ImGui::SameLine();
+                    bool kernelPicked = ImGui::RadioButton("Per Substep", &stepKernel, 0);
+                    ImGui::SameLine();
+                    kernelPicked |= ImGui::RadioButton("Tiled", &stepKernel, 1);
+                    ImGui::SameLine();
+                    kernelPicked |= ImGui::RadioButton("CG", &stepKernel, 2);
+                    if (kernelPicked) {
+                        try {
+                            gpuSolver->setStepKernel(static_cast<GpuStepKernel>(stepKernel));
+                        } catch (const std::exception& e) {
+                            gpuInitError = e.what();
+                        }
+                    }
+                    if (gpuSolver->stepKernel() == GpuStepKernel::ConjugateGradient) {
+                        int cgIterations = gpuSolver->cgIterations();
+                        if (ImGui::SliderInt("GPU CG Iters", &cgIterations, 1, 64)) {
+                            gpuSolver->setCgIterations(cgIterations);
+                        }
+                    }
+                    GpuStepKernelOptions kernelOptions = gpuSolver->stepKernelOptions();
+                    int groupShape = kernelOptions.groupSizeY > 1 ? 1 : 0;
+                    ImGui::Text("GPU Groups");
+                    ImGui::SameLine();
+                    const bool linearGroups = ImGui::RadioButton("128x1", &groupShape, 0);
+                    ImGui::SameLine();
+                    const bool tileGroups = ImGui::RadioButton("16x8", &groupShape, 1);
+                    const bool bendToggled = ImGui::Checkbox("GPU Bend Springs", &kernelOptions.bendSprings);
+                    if (linearGroups || tileGroups || bendToggled) {
+                        kernelOptions.groupSizeX = groupShape == 1 ? 16 : 128;
+                        kernelOptions.groupSizeY = groupShape == 1 ? 8 : 1;
+                        try {
+                            gpuSolver->setStepKernelOptions(kernelOptions);
+                        } catch (const std::exception& e) {
+                            gpuInitError = e.what();
+                        }
+                    }
+                    int strainIterations = gpuSolver->strainIterations();
+                    if (ImGui::SliderInt("GPU Strain Iters", &strainIterations, 0, 16)) {
+                        gpuSolver->setStrainIterations(strainIterations);
+                    }
+                    int storage = static_cast<int>(gpuSolver->particleLayout());
+                    ImGui::Text("GPU Storage");
+                    ImGui::SameLine();
+                    bool storagePicked = ImGui::RadioButton("vec4", &storage, 0);
+                    ImGui::SameLine();
+                    storagePicked |= ImGui::RadioButton("packed", &storage, 1);
+                    ImGui::SameLine();
+                    storagePicked |= ImGui::RadioButton("fp16 vel", &storage, 2);
+                    if (storagePicked && storage != static_cast<int>(gpuSolver->particleLayout())) {
+                        rebuildGpuSolver(static_cast<GpuParticleLayout>(storage));
+                    }
+                    if (ImGui::Button("Autotune GPU Kernels")) {
+                        autotuneGpuSolver();
+                    }
+                    if (kernelConfigKnown) {
+                        ImGui::Text(
+                            "Tuned: %s %ux%u, %.3f ms/step",
+                            particleLayoutName(kernelConfig.layout),
+                            kernelConfig.options.groupSizeX,
+                            kernelConfig.options.groupSizeY,
+                            kernelConfig.stepMilliseconds);
+                    }
+                    if (ImGui::Checkbox("GPU Banner Batch", &bannersEnabled) && bannersEnabled && !bannerBatch) {
+                        std::vector<GpuClothInstanceDesc> banners(kBannerGridSide * kBannerGridSide);
+                        for (std::size_t i = 0; i < banners.size(); ++i) {
+                            const float half = 0.5f * static_cast<float>(kBannerGridSide - 1);
+                            const float x = static_cast<float>(i % kBannerGridSide) - half;
+                            const float z = static_cast<float>(i / kBannerGridSide) - half;
+                            banners[i].rows = kBannerRows;
+                            banners[i].cols = kBannerCols;
+                            banners[i].center = glm::vec3(0.6f * x, 2.35f, 0.6f * z);
+                            banners[i].windStrength = 0.5f * static_cast<float>(i % 5);
+                        }
+                        try {
+                            bannerBatch = std::make_unique<GpuClothBatch>(banners);
+                        } catch (const std::exception& e) {
+                            gpuInitError = e.what();
+                            bannersEnabled = false;
+                        }
+                    }
+                    if (!gpuInitError.empty()) {
+                        ImGui::TextWrapped("%s", gpuInitError.c_str());
+                    }
+                }
 
                 ImGui::Separator();
                 ImGui::Text("Render Solver: %s", useGpuSolver && gpuAvailable ? "GPU" : "CPU");
                 ImGui::Text("Step CPU: %.3f ms", cpuStepMs);
                 if (gpuAvailable) {
-                    ImGui::Text("Step GPU: %.3f ms", gpuStepMs);
+                    ImGui::Text("Step GPU: %.3f ms (submit %.3f ms)", gpuStepMs, gpuSubmitMs);
+                    ImGui::Text(
+                        "GPU state: %zu B/particle",
+                        gpuSolver->positionStride() + gpuSolver->velocityStride());
                     ImGui::Text("CPU/GPU RMSE: %.6f", cpuGpuRmse);
+                    if (bannersEnabled && bannerBatch) {
+                        ImGui::Text(
+                            "Banners: %zu cloths, %zu particles, %.3f ms",
+                            bannerBatch->instanceCount(),
+                            bannerBatch->particleCount(),
+                            gpuTimer.milliseconds(kTimerBatch));
+                    }
                 }
+                ImGui::Text(
+                    "GPU Shadow %.3f | Main %.3f | UI %.3f ms",
+                    gpuTimer.milliseconds(kTimerShadow),
+                    gpuTimer.milliseconds(kTimerMain),
+                    gpuTimer.milliseconds(kTimerUi));
+                const SceneCullStats& mainCull = sceneInstances.cullStats(ScenePass::Main);
+                const SceneCullStats& shadowCull = sceneInstances.cullStats(ScenePass::Depth);
+                ImGui::Text(
+                    "Scene: %zu props, %zu meshes | cloth %s/%s",
+                    sceneInstances.instanceCount(),
+                    sceneInstances.batchCount(),
+                    clothInMainPass ? "drawn" : "culled",
+                    clothInShadowPass ? "drawn" : "culled");
+                ImGui::Text(
+                    "Culled main %zu/%zu, shadow %zu/%zu (%zu+%zu nodes)",
+                    mainCull.culled,
+                    sceneInstances.instanceCount(),
+                    shadowCull.culled,
+                    sceneInstances.instanceCount(),
+                    mainCull.nodesTested,
+                    shadowCull.nodesTested);
                 ImGui::Separator();
                 ImGui::Text("P: Pause  R: Reset  F1: Wireframe  H: Toggle UI");
                 ImGui::Text("Right Mouse: Look Around");
@@ -520,43 +789,63 @@ int main() {
 
                 if (gpuAvailable) {
                     const auto gpuStart = std::chrono::high_resolution_clock::now();
+                    gpuTimer.begin(kTimerSolver);
                     gpuSolver->step(dt);
+                    gpuTimer.end();
                     const auto gpuEnd = std::chrono::high_resolution_clock::now();
-                    gpuStepMs = std::chrono::duration<double, std::milli>(gpuEnd - gpuStart).count();
+                    gpuSubmitMs = std::chrono::duration<double, std::milli>(gpuEnd - gpuStart).count();
+                }
+                if (bannersEnabled && bannerBatch) {
+                    gpuTimer.begin(kTimerBatch);
+                    bannerBatch->step(dt);
+                    gpuTimer.end();
                 }
             }
 
-            const std::vector<glm::vec3>& renderPositions =
-                (useGpuSolver && gpuAvailable) ? gpuSolver->getPositions() : cpuSolver.getPositions();
-            clothMesh.updatePositions(renderPositions);
-
-            if (gpuAvailable) {
-                const std::vector<glm::vec3>& cpuPositions = cpuSolver.getPositions();
-                const std::vector<glm::vec3>& gpuPositions = gpuSolver->getPositions();
-                double sq = 0.0;
-                const std::size_t n = cpuPositions.size();
-                for (std::size_t i = 0; i < n; ++i) {
-                    const glm::vec3 d = cpuPositions[i] - gpuPositions[i];
-                    sq += static_cast<double>(glm::dot(d, d));
-                }
-                cpuGpuRmse = n > 0 ? std::sqrt(sq / static_cast<double>(n)) : 0.0;
-
-                if (!paused) {
-                    compareAccumSec += dt;
-                    compareAccumCpuMs += cpuStepMs;
-                    compareAccumGpuMs += gpuStepMs;
-                    compareAccumRmse += cpuGpuRmse;
-                    compareSamples += 1;
-                    if (compareAccumSec >= 1.0 && compareSamples > 0) {
-                        std::cout << "[SolverCompare] avg CPU " << (compareAccumCpuMs / compareSamples)
-                                  << " ms | avg GPU " << (compareAccumGpuMs / compareSamples)
-                                  << " ms | avg RMSE " << (compareAccumRmse / compareSamples) << '\n';
-                        compareAccumSec = 0.0;
-                        compareAccumCpuMs = 0.0;
-                        compareAccumGpuMs = 0.0;
-                        compareAccumRmse = 0.0;
-                        compareSamples = 0;
+            if (useGpuSolver && gpuAvailable) {
+                // Drawn straight from the solver's buffers; nothing is read back in steady state.
+                clothMesh.setExternalStreams(
+                    gpuSolver->positionBuffer(), gpuSolver->normalBuffer(), gpuSolver->positionStride());
+            } else {
+                clothMesh.setExternalStreams(0, 0, 0);
+                clothMesh.updatePositions(cpuSolver.getPositions());
+            }
+
+            if (gpuAvailable && !paused) {
+                compareAccumSec += dt;
+                compareAccumCpuMs += cpuStepMs;
+                compareAccumGpuMs += gpuStepMs;
+                compareAccumShadowMs += gpuTimer.milliseconds(kTimerShadow);
+                compareAccumMainMs += gpuTimer.milliseconds(kTimerMain);
+                compareAccumUiMs += gpuTimer.milliseconds(kTimerUi);
+                compareSamples += 1;
+                if (compareAccumSec >= 1.0 && compareSamples > 0) {
+                    // Compared against the CPU solver at the same frame, so this takes the blocking readback path.
+                    gpuSolver->syncPositions();
+                    const std::vector<glm::vec3>& cpuPositions = cpuSolver.getPositions();
+                    const std::vector<glm::vec3>& gpuPositions = gpuSolver->getPositions();
+                    double sq = 0.0;
+                    const std::size_t n = cpuPositions.size();
+                    for (std::size_t i = 0; i < n; ++i) {
+                        const glm::vec3 d = cpuPositions[i] - gpuPositions[i];
+                        sq += static_cast<double>(glm::dot(d, d));
                     }
+                    cpuGpuRmse = n > 0 ? std::sqrt(sq / static_cast<double>(n)) : 0.0;
+
+                    std::cout << "[SolverCompare] avg CPU " << (compareAccumCpuMs / compareSamples)
+                              << " ms | avg GPU " << (compareAccumGpuMs / compareSamples)
+                              << " ms | RMSE " << cpuGpuRmse << " | GPU state "
+                              << (gpuSolver->positionStride() + gpuSolver->velocityStride()) << " B | GPU shadow "
+                              << (compareAccumShadowMs / compareSamples) << " main "
+                              << (compareAccumMainMs / compareSamples) << " ui "
+                              << (compareAccumUiMs / compareSamples) << " ms\n";
+                    compareAccumSec = 0.0;
+                    compareAccumCpuMs = 0.0;
+                    compareAccumGpuMs = 0.0;
+                    compareAccumShadowMs = 0.0;
+                    compareAccumMainMs = 0.0;
+                    compareAccumUiMs = 0.0;
+                    compareSamples = 0;
                 }
             }
 
@@ -566,52 +855,66 @@ int main() {
             const glm::mat4 lightProjection = glm::ortho(-7.0f, 7.0f, -7.0f, 7.0f, 0.5f, 22.0f);
             const glm::mat4 lightView = glm::lookAt(lightPos, glm::vec3(0.0f, 0.8f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
             const glm::mat4 lightSpace = lightProjection * lightView;
+            const glm::mat4 cameraViewProjection = camera.getProjectionMatrix() * camera.getViewMatrix();
+
+            glm::vec3 clothBoundsMin(0.0f);
+            glm::vec3 clothBoundsMax(0.0f);
+            if (useGpuSolver && gpuAvailable) {
+                gpuSolver->getBounds(clothBoundsMin, clothBoundsMax);
+            } else {
+                cpuSolver.getBounds(clothBoundsMin, clothBoundsMax);
+            }
+            clothInShadowPass = Frustum::fromMatrix(lightSpace).intersects(clothBoundsMin, clothBoundsMax);
+            clothInMainPass = Frustum::fromMatrix(cameraViewProjection).intersects(clothBoundsMin, clothBoundsMax);
+            sceneInstances.cull(ScenePass::Depth, lightSpace);
+            sceneInstances.cull(ScenePass::Main, cameraViewProjection);
 
+            gpuTimer.begin(kTimerShadow);
             glViewport(0, 0, kShadowWidth, kShadowHeight);
             glBindFramebuffer(GL_FRAMEBUFFER, depthMapFbo);
             glClear(GL_DEPTH_BUFFER_BIT);
             glEnable(GL_POLYGON_OFFSET_FILL);
             glPolygonOffset(2.0f, 4.0f);
 
+            FrameUniformData frameUniforms;
+            frameUniforms.view = camera.getViewMatrix();
+            frameUniforms.proj = camera.getProjectionMatrix();
+            frameUniforms.lightSpace = lightSpace;
+            frameUniforms.cameraPos = glm::vec4(camera.getPosition(), 1.0f);
+            frameUniforms.lightDir = glm::vec4(lightDirForShading, 0.0f);
+            frameUniforms.pointLightPos = glm::vec4(1.8f, 2.2f, 1.4f, 1.0f);
+            frameUniforms.pointLightColor = glm::vec4(1.0f, 0.88f, 0.72f, 1.45f);
+            frameUniforms.lighting = glm::vec4(0.22f, 0.0f, 0.0f, 0.0f);
+            renderUniforms.update(frameUniforms);
+
             depthShader.use();
-            depthShader.setMat4("uLightSpace", lightSpace);
-            drawSceneDepth(depthShader, clothMesh, sceneObjects);
+            drawSceneDepth(clothMesh, clothInShadowPass, sceneInstances);
 
             glDisable(GL_POLYGON_OFFSET_FILL);
             glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            gpuTimer.end();
+
+            gpuTimer.begin(kTimerMain);
 
             glViewport(0, 0, fbWidth, fbHeight);
             glClearColor(0.07f, 0.08f, 0.10f, 1.0f);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
             shadingShader.use();
-            shadingShader.setMat4("uView", camera.getViewMatrix());
-            shadingShader.setMat4("uProj", camera.getProjectionMatrix());
-            shadingShader.setMat4("uLightSpace", lightSpace);
-            shadingShader.setVec3("uCameraPos", camera.getPosition());
-            shadingShader.setVec3("uLightDir", lightDirForShading);
-            shadingShader.setVec3("uPointLightPos", glm::vec3(1.8f, 2.2f, 1.4f));
-            shadingShader.setVec3("uPointLightColor", glm::vec3(1.0f, 0.88f, 0.72f));
-            shadingShader.setFloat("uPointLightIntensity", 1.45f);
-            shadingShader.setFloat("uAmbientStrength", 0.22f);
-            shadingShader.setInt("uShadowMap", 0);
 
             glActiveTexture(GL_TEXTURE0);
             glBindTexture(GL_TEXTURE_2D, depthMap);
 
-            drawSceneMain(
-                shadingShader,
-                clothMesh,
-                sceneObjects,
-                glm::vec3(0.79f, 0.30f, 0.24f),
-                0.36f,
-                36.0f);
+            drawSceneMain(clothMesh, clothInMainPass, sceneInstances, clothMaterial);
+            gpuTimer.end();
 
             ImGui::Render();
             if (wireframe) {
                 glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
             }
+            gpuTimer.begin(kTimerUi);
             ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            gpuTimer.end();
             if (wireframe) {
                 glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
             }
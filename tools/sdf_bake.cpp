@@ -0,0 +1,70 @@
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+#include "ObjLoader.h"
+#include "SdfGrid.h"
+
+namespace {
+// Defaults match the pedestal collider in app_main.cpp so a pre-bake is picked up at startup.
+constexpr float kDefaultVoxelSize = 0.02f;
+constexpr float kDefaultBandWidth = 0.08f;
+constexpr const char* kDefaultCacheDir = "cache/sdf";
+
+void printUsage() {
+    std::cerr << "usage: sdf_bake <mesh.obj> [--scale s] [--voxel size] [--band width] [--cache dir]\n";
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage();
+        return 1;
+    }
+
+    const std::string meshPath = argv[1];
+    float scale = 1.0f;
+    float voxelSize = kDefaultVoxelSize;
+    float bandWidth = kDefaultBandWidth;
+    std::string cacheDir = kDefaultCacheDir;
+
+    for (int i = 2; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            printUsage();
+            return 1;
+        }
+        const std::string value = argv[++i];
+        if (arg == "--scale") {
+            scale = std::stof(value);
+        } else if (arg == "--voxel") {
+            voxelSize = std::stof(value);
+        } else if (arg == "--band") {
+            bandWidth = std::stof(value);
+        } else if (arg == "--cache") {
+            cacheDir = value;
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    try {
+        const ObjMeshData mesh = ObjLoader::load(meshPath, scale);
+        const std::uint64_t key = SdfGrid::cacheKey(mesh, voxelSize, bandWidth);
+        const std::string outPath = SdfGrid::cachePath(cacheDir, key);
+
+        const auto grid = SdfGrid::bake(mesh, voxelSize, bandWidth);
+        grid->save(outPath);
+
+        const glm::uvec3& dims = grid->brickDims();
+        std::cout << meshPath << ": " << mesh.indices.size() / 3 << " triangles, " << dims.x << "x" << dims.y << "x"
+                  << dims.z << " bricks, " << grid->brickCount() << " stored -> " << outPath << '\n';
+    } catch (const std::exception& e) {
+        std::cerr << "sdf_bake: " << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}